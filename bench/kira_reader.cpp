@@ -0,0 +1,108 @@
+// Compare the single-pass `kira_reader` against the former two-pass
+// `std::ifstream` tokenizer on a synthetic Kira reduction result.
+//
+// Usage: bench_kira_reader [num_terms] [terms_per_ibp] [file]
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include "kira.hpp"
+
+static const std::string family = "banana";
+
+static std::string random_integral(std::mt19937& rng) {
+    std::string integral = family + "[";
+    for (int i = 0; i < 9; i++) {
+        integral += std::to_string(rng() % 4);
+        if (i != 8)
+            integral += ",";
+    }
+    return integral + "]";
+}
+
+static void generate(const std::string& filename, std::size_t num_terms, std::size_t terms_per_ibp) {
+    std::mt19937 rng(0);
+    std::ofstream out(filename);
+    for (std::size_t n = 0; n < num_terms; ) {
+        out << random_integral(rng) << " =" << std::endl;
+        for (std::size_t k = 0; k < terms_per_ibp && n < num_terms; k++, n++) {
+            out << "  + " << random_integral(rng) << "*((" << rng() % 1000
+                << "*d^2-" << rng() % 1000 << "*s*d+" << rng() % 1000
+                << ")/(" << rng() % 1000 << "*s-" << rng() % 1000 << "*d))" << std::endl;
+        }
+        out << ";" << std::endl;
+    }
+}
+
+// the former read_ibps(): count_ibps() followed by a second scan
+static std::size_t legacy_scan(const std::string& filename, std::size_t& heads) {
+    std::string ibp;
+    heads = 0;
+    {
+        std::ifstream in(filename);
+        while (true) {
+            in >> ibp;
+            if (in.eof())
+                break;
+            if (ibp.find(family) != std::string::npos
+             && ibp.find('*') == std::string::npos)
+                heads++;
+        }
+    }
+    std::size_t bytes = 0;
+    std::ifstream in(filename);
+    while (true) {
+        in >> ibp;
+        if (in.eof())
+            break;
+        if (ibp.find(family) != std::string::npos) {
+            std::size_t asterisk = ibp.find('*');
+            if (asterisk != std::string::npos)
+                bytes += ibp.size() - asterisk - 1;
+        }
+    }
+    return bytes;
+}
+
+static std::size_t reader_scan(const std::string& filename, std::size_t& heads) {
+    kira_reader reader(filename, family);
+    heads = reader.num_heads();
+    std::size_t bytes = 0, n = reader.num_records();
+    for (std::size_t r = 0; r < n; r++) {
+        auto record = reader[r];
+        if (!record.head)
+            bytes += record.coefficient.size();
+    }
+    return bytes;
+}
+
+int main(int argc, char** argv) {
+    std::size_t num_terms = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4000000;
+    std::size_t terms_per_ibp = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 24;
+    std::string filename = argc > 3 ? argv[3] : "/tmp/bench_kira_reader.m";
+
+    std::cout << "Generating " << num_terms << " terms into " << filename << " ..." << std::endl;
+    generate(filename, num_terms, terms_per_ibp);
+
+    std::size_t legacy_heads, reader_heads;
+    auto t0 = std::chrono::high_resolution_clock::now();
+    auto legacy_bytes = legacy_scan(filename, legacy_heads);
+    auto t1 = std::chrono::high_resolution_clock::now();
+    auto reader_bytes = reader_scan(filename, reader_heads);
+    auto t2 = std::chrono::high_resolution_clock::now();
+
+    std::chrono::duration<double, std::milli> legacy_ms = t1 - t0, reader_ms = t2 - t1;
+    std::cout << "ifstream (two passes): " << legacy_ms.count() << " ms, "
+              << legacy_heads << " IBPs, " << legacy_bytes << " coefficient bytes" << std::endl;
+    std::cout << "kira_reader (one pass): " << reader_ms.count() << " ms, "
+              << reader_heads << " IBPs, " << reader_bytes << " coefficient bytes" << std::endl;
+    if (legacy_heads != reader_heads || legacy_bytes != reader_bytes) {
+        std::cerr << "Mismatch between the two readers!" << std::endl;
+        return 1;
+    }
+    std::cout << "Speedup: " << legacy_ms.count() / reader_ms.count() << "x" << std::endl;
+    std::remove(filename.c_str());
+}
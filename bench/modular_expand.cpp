@@ -0,0 +1,98 @@
+// Compare expanding the IBP relations of the examples in eps with exact
+// GiNaC series (eps_expander) against the modular expansion engine
+// (modular_expander), and check that both give the same linear forms.
+//
+// Usage: bench_modular_expand [config_file.yaml ...]
+//
+// The configs default to the three examples, whose Kira reductions have
+// to be available as for the main program.
+
+#include <chrono>
+#include <iostream>
+#include "config.hpp"
+
+typedef std::chrono::duration<double, std::milli> milliseconds;
+
+// Expand every relation, collecting one linear form per order. Relations
+// with a pole at eps = 0, or that are not linear in the unknowns, give
+// no forms.
+template <typename F>
+static std::vector<std::vector<linear_form>> expand_all(const std::vector<GiNaC::ex>& relations, F expand) {
+    std::vector<std::vector<linear_form>> results;
+    for (auto& relation: relations) {
+        std::vector<linear_form> forms;
+        try {
+            if (!expand(relation, forms))
+                forms.clear();
+        } catch (linear_form_error&) {
+            forms.clear();
+        }
+        results.push_back(std::move(forms));
+    }
+    return results;
+}
+
+// returns the number of mismatching relations
+static int run(const char* config_file) {
+    config_parser configure(config_file);
+    configure.read_ibps();
+    configure.expand_ibps();
+
+    auto& expansions = configure.expansions();
+    auto& unknowns = configure.unknowns();
+    int order = expansions.empty() ? 0 : expansions.begin()->second.nops() - 1;
+    unknown_index indices;
+    int num_unknowns = unknowns.nops();
+    for (int i = 0; i < num_unknowns; i++)
+        indices[unknowns[i]] = i;
+    std::vector<GiNaC::ex> relations;
+    for (auto& key: sorted_keys(configure.ibps()))
+        relations.push_back(configure.ibps().at(key));
+
+    eps_expander exact(configure.dimension(), configure.target_dimension(), expansions);
+    auto begin = std::chrono::high_resolution_clock::now();
+    auto exact_forms = expand_all(relations, [&](const GiNaC::ex& relation, std::vector<linear_form>& forms) {
+        std::vector<GiNaC::ex> coefficients;
+        if (!exact.expand(relation, order, coefficients))
+            return false;
+        for (auto& coefficient: coefficients)
+            forms.push_back(to_linear_form(coefficient, indices));
+        return true;
+    });
+    milliseconds exact_time = std::chrono::high_resolution_clock::now() - begin;
+
+    modular_expander modular(configure.dimension(), configure.target_dimension(), expansions);
+    begin = std::chrono::high_resolution_clock::now();
+    auto modular_forms = expand_all(relations, [&](const GiNaC::ex& relation, std::vector<linear_form>& forms) {
+        return modular.expand(relation, order, indices, forms);
+    });
+    milliseconds modular_time = std::chrono::high_resolution_clock::now() - begin;
+
+    int mismatches = 0;
+    int num_relations = relations.size();
+    for (int r = 0; r < num_relations; r++) {
+        bool same = exact_forms[r].size() == modular_forms[r].size();
+        for (std::size_t i = 0; same && i < exact_forms[r].size(); i++) {
+            GiNaC::ex difference = exact_forms[r][i].to_ex(unknowns) - modular_forms[r][i].to_ex(unknowns);
+            same = difference.expand().is_zero();
+        }
+        if (!same)
+            mismatches++;
+    }
+
+    std::cout << config_file << ": " << num_relations << " relations, order " << order << std::endl;
+    std::cout << "exact:   " << exact_time.count() << " ms" << std::endl;
+    std::cout << "modular: " << modular_time.count() << " ms" << std::endl;
+    std::cout << "mismatching relations: " << mismatches << std::endl;
+    return mismatches;
+}
+
+int main(int argc, char** argv) {
+    std::vector<const char*> config_files(argv + 1, argv + argc);
+    if (config_files.empty())
+        config_files = {"examples/bubble.yaml", "examples/banana.yaml", "examples/equalbanana.yaml"};
+    int mismatches = 0;
+    for (auto config_file: config_files)
+        mismatches += run(config_file);
+    return mismatches != 0;
+}
@@ -0,0 +1,99 @@
+// Compare evaluating the IBP coefficients of a Kira reduction result at
+// numeric kinematics by GiNaC substitution and normalization against the
+// compiled Horner programs of `compiled_rational`.
+//
+// Usage: bench_rational_eval [config_file.yaml]
+//
+// The config defaults to examples/banana.yaml, whose Kira reduction has to
+// be available as for the main program.
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <yaml-cpp/yaml.h>
+#include "evaluate.hpp"
+#include "kira.hpp"
+
+typedef std::chrono::duration<double, std::milli> milliseconds;
+
+int main(int argc, char** argv) {
+    const char* config_file = (argc > 1) ? argv[1] : "examples/banana.yaml";
+    YAML::Node config = YAML::LoadFile(config_file);
+    std::string family = config["integralfamily"]["name"].as<std::string>();
+    std::string kira_dir = config["kiradir"].as<std::string>();
+    auto filename = std::filesystem::path(kira_dir).append("results")
+        .append(family).append(config["kirafile"].as<std::string>());
+
+    // symbols as in config_parser::read_symbols()
+    GiNaC::symtab symbol_table;
+    GiNaC::lst params;
+    std::ifstream symbol_file(std::filesystem::path(kira_dir).append("sectormappings").append("variables"));
+    std::string name;
+    while (symbol_file >> name) {
+        symbol_table[name] = GiNaC::symbol(name);
+        if (name != "d")
+            params.append(symbol_table[name]);
+    }
+    if (symbol_table.find("d") == symbol_table.end())
+        symbol_table["d"] = GiNaC::symbol("d");
+    GiNaC::symbol d = GiNaC::ex_to<GiNaC::symbol>(symbol_table["d"]);
+
+    GiNaC::lst kinematics;
+    std::vector<GiNaC::numeric> values;
+    GiNaC::parser value_parser;
+    auto numerics = config["kinematics_numerics"].as<std::vector<std::vector<std::string>>>();
+    for (auto param: params) {
+        GiNaC::numeric value = 0;
+        for (auto& key_value: numerics) {
+            if (key_value[0] == GiNaC::ex_to<GiNaC::symbol>(param).get_name())
+                value = GiNaC::ex_to<GiNaC::numeric>(value_parser(key_value[1]));
+        }
+        kinematics.append(param == value);
+        values.push_back(value);
+    }
+
+    kira_reader reader(filename, family);
+    GiNaC::parser parser(symbol_table);
+    std::vector<GiNaC::ex> coefficients;
+    for (std::size_t r = 0; r < reader.num_records(); r++) {
+        auto record = reader[r];
+        if (!record.head)
+            coefficients.push_back(parser(std::string(record.coefficient)));
+    }
+    std::size_t n = coefficients.size();
+
+    // GiNaC: what the read workers do with numeric kinematics
+    auto begin = std::chrono::high_resolution_clock::now();
+    std::vector<GiNaC::ex> reference;
+    for (auto& c: coefficients)
+        reference.push_back(c.subs(kinematics, GiNaC::subs_options::algebraic).normal());
+    milliseconds ginac_time = std::chrono::high_resolution_clock::now() - begin;
+
+    begin = std::chrono::high_resolution_clock::now();
+    std::vector<compiled_rational> compiled;
+    for (auto& c: coefficients) {
+        GiNaC::ex fraction = c.normal().numer_denom();
+        compiled.push_back(compiled_rational(fraction.op(0).expand(), fraction.op(1).expand(), d, params));
+    }
+    milliseconds compile_time = std::chrono::high_resolution_clock::now() - begin;
+
+    begin = std::chrono::high_resolution_clock::now();
+    std::vector<GiNaC::ex> exact;
+    for (auto& c: compiled)
+        exact.push_back(c(values));
+    milliseconds exact_time = std::chrono::high_resolution_clock::now() - begin;
+
+    std::size_t mismatches = 0;
+    for (std::size_t i = 0; i < n; i++) {
+        if (!(exact[i] - reference[i]).normal().is_zero())
+            mismatches++;
+    }
+
+    std::cout << n << " coefficients" << std::endl;
+    std::cout << "GiNaC subs + normal:      " << ginac_time.count() << " ms" << std::endl;
+    std::cout << "compilation:              " << compile_time.count() << " ms" << std::endl;
+    std::cout << "compiled evaluation:      " << exact_time.count() << " ms" << std::endl;
+    std::cout << "mismatches:               " << mismatches << std::endl;
+    return mismatches != 0;
+}
@@ -0,0 +1,106 @@
+// Compare building the SDP coefficient matrices in a single pass over the
+// parsed linear forms against the former symbolic route, which
+// differentiates every block by every unknown and then substitutes all
+// unknowns by zero.
+//
+// Usage: bench_sparse_ibps [config_file.yaml]
+//
+// The config defaults to examples/banana.yaml, whose Kira reduction has to
+// be available as for the main program.
+
+#include <chrono>
+#include <iostream>
+#include "config.hpp"
+
+typedef std::chrono::duration<double, std::milli> milliseconds;
+
+int main(int argc, char** argv) {
+    const char* config_file = (argc > 1) ? argv[1] : "examples/banana.yaml";
+    config_parser configure(config_file);
+    configure.read_ibps();
+    configure.expand_ibps();
+
+    auto parser = configure.get_polynomial_parser();
+    auto generator = parser.get_polynomial_generator();
+    auto polynomials = generator.generate_from_config();
+
+    auto begin = std::chrono::high_resolution_clock::now();
+    std::vector<linear_block> blocks;
+    for (auto& polynomial: polynomials) {
+        auto parser_output = parser.parse(polynomial);
+        if (parser_output.first)
+            blocks.push_back(std::move(parser_output.second));
+    }
+    milliseconds parse_time = std::chrono::high_resolution_clock::now() - begin;
+
+    auto& unknowns = configure.unknowns();
+    int num_unknowns = unknowns.nops(), num_blocks = blocks.size();
+    GiNaC::lst zero_rules;
+    for (int i = 0; i < num_unknowns; i++) {
+        zero_rules.append(unknowns[i] == 0);
+    }
+    // the blocks as the former parser returned them
+    std::vector<GiNaC::matrix> matrices;
+    for (auto& block: blocks) {
+        GiNaC::matrix matrix(block.size(), block.size());
+        for (int r = 0; r < block.size(); r++) {
+            for (int c = 0; c < block.size(); c++)
+                matrix(r, c) = block(r, c).to_ex(unknowns);
+        }
+        matrices.push_back(matrix);
+    }
+
+    // symbolic: one diff() and subs() of the whole block per unknown
+    begin = std::chrono::high_resolution_clock::now();
+    std::vector<std::vector<GiNaC::matrix>> symbolic(num_unknowns + 1);
+    for (int j = 0; j < num_blocks; j++) {
+        GiNaC::ex block = matrices[j];
+        symbolic[num_unknowns].push_back(GiNaC::ex_to<GiNaC::matrix>(
+            block.subs(zero_rules, GiNaC::subs_options::algebraic)));
+        for (int i = 0; i < num_unknowns; i++) {
+            symbolic[i].push_back(GiNaC::ex_to<GiNaC::matrix>(
+                block.diff(GiNaC::ex_to<GiNaC::symbol>(unknowns[i]))
+                     .subs(zero_rules, GiNaC::subs_options::algebraic)));
+        }
+    }
+    milliseconds symbolic_time = std::chrono::high_resolution_clock::now() - begin;
+
+    // sparse: every linear form scattered into all matrices at once
+    begin = std::chrono::high_resolution_clock::now();
+    std::vector<std::vector<symmetric_matrix>> sparse(num_unknowns + 1);
+    for (int j = 0; j < num_blocks; j++) {
+        int n = blocks[j].size();
+        for (int i = 0; i <= num_unknowns; i++)
+            sparse[i].push_back(symmetric_matrix(n));
+        auto& entries = blocks[j].packed();
+        std::size_t num_entries = entries.size();
+        for (std::size_t e = 0; e < num_entries; e++) {
+            auto& form = entries[e];
+            std::size_t terms = form.indices.size();
+            for (std::size_t k = 0; k < terms; k++)
+                sparse[form.indices[k]][j].packed()[e] = form.values[k];
+            sparse[num_unknowns][j].packed()[e] = form.constant;
+        }
+    }
+    milliseconds sparse_time = std::chrono::high_resolution_clock::now() - begin;
+
+    int mismatches = 0;
+    for (int i = 0; i <= num_unknowns; i++) {
+        for (int j = 0; j < num_blocks; j++) {
+            int n = matrices[j].rows();
+            for (int r = 0; r < n; r++) {
+                for (int c = 0; c < n; c++) {
+                    if (!(symbolic[i][j](r, c) - sparse[i][j](r, c)).expand().is_zero())
+                        mismatches++;
+                }
+            }
+        }
+    }
+
+    std::cout << num_blocks << " blocks, " << num_unknowns << " unknowns" << std::endl;
+    std::cout << "parse:    " << parse_time.count() << " ms" << std::endl;
+    std::cout << "symbolic: " << symbolic_time.count() << " ms" << std::endl;
+    std::cout << "sparse:   " << sparse_time.count() << " ms" << std::endl;
+    std::cout << "mismatching entries: " << mismatches << std::endl;
+    return mismatches != 0;
+}
@@ -10,6 +10,13 @@
 #include "solver.hpp"
 #include "utils.hpp"
 #include "asy.hpp"
+#include "pool.hpp"
+#include "store.hpp"
+#include "series.hpp"
+#include "linear.hpp"
+#include "index.hpp"
+#include "evaluate.hpp"
+#include "modular.hpp"
 
 
 class config_parser {
@@ -27,7 +34,7 @@ public:
      * @param seed random seed for generating numeric Feynman parameters
      * @param trials number of trials
      */
-    bool check_euclidean(unsigned long seed = 0, int trials = 65536);
+    bool check_euclidean(unsigned long seed = 0, int trials = 1 << 20);
 #endif // NO_GSL
 
     // IBP related methods
@@ -36,7 +43,7 @@ public:
     void expand_ibps();
     void dump_raw_ibps(std::ostream& out);
     void dump_expanded_ibps(std::ostream& out);
-    std::map<std::string, GiNaC::symtab> read_selected_ibps(const GiNaC::symtab& integrals);
+    integral_map<integral_symtab> read_selected_ibps(const integral_symtab& integrals);
 
     // dimensional shifting relations and differential equations
     GiNaC::matrix get_shift_to_upper_dim();
@@ -49,7 +56,9 @@ public:
                                  numeric_ibp_table,
                                  effective_feynman_params,
                                  feynman_params,
-                                 config_file);
+                                 log_symbol,
+                                 config_file,
+                                 max_subprocesses);
     }
 
     // Export internal data to a master solver.
@@ -87,11 +96,67 @@ public:
         return symanzik_F;
     }
 
+    // unknown master integrals I[...]_k, available after expand_ibps()
+    const GiNaC::lst& unknowns() {
+        return unknown_list;
+    }
+
+    // IBP relations before the expansion, available after read_ibps()
+    const integral_symtab& ibps() {
+        return ibp_table;
+    }
+
+    // expansions I[...] -> {I[...]_0, I[...]_1, ...} of all integrals,
+    // available after expand_ibps()
+    const std::map<GiNaC::ex, GiNaC::lst, GiNaC::ex_is_less>& expansions() {
+        return integral_expansions;
+    }
+
+    const GiNaC::symbol& dimension() {
+        return GiNaC::ex_to<GiNaC::symbol>(symbol_table["d"]);
+    }
+
+    int target_dimension() {
+        return d0;
+    }
+
+    const GiNaC::lst& kinematics() {
+        return kinematics_numerics;
+    }
+
+    // kinematic points of `kinematics_scan`, empty if there is no scan
+    const std::vector<GiNaC::lst>& scan_points() {
+        return kinematics_scan;
+    }
+
+    /**
+     * Move to another kinematic point. In a scan, IBP relations are read
+     * with symbolic kinematics once, and only substituted here, so that
+     * expand_ibps() may follow directly.
+     * @param numerics numeric values of the kinematic invariants
+     */
+    void set_kinematics(const GiNaC::lst& numerics);
+
+    int subprocesses() {
+        return max_subprocesses;
+    }
+
+    void set_subprocesses(int n) {
+        max_subprocesses = n;
+    }
+
     // Options
     bool will_check_euclidean;
+    bool will_minimize_euclidean;
+    int euclidean_trials;
     bool will_dump_raw_ibps;
     bool will_dump_expanded_ibps;
     bool will_dump_symbolic_sdp;
+    bool will_warm_start;
+    // number of points of a scan computed at the same time
+    int scan_workers;
+    // file receiving the results of a scan, "" for the default
+    std::string scan_output;
 
     friend class master_solver;
 private:
@@ -104,20 +169,42 @@ private:
     std::string ibp_result_filename;
     
     GiNaC::symtab symbol_table;
-    GiNaC::symtab integral_table;
-    GiNaC::symtab ibp_table;
-    std::vector<std::string> master_table;
+    integral_symtab integral_table;
+    integral_symtab ibp_table;
+    std::vector<integral_index> master_table;
     GiNaC::lst kinematics_numerics;
-    std::vector<GiNaC::symtab> numeric_integral_table;
-    std::vector<GiNaC::symtab> numeric_ibp_table;
+    std::vector<GiNaC::lst> kinematics_scan;
+    // whether IBP relations are read with symbolic kinematics, which are
+    // substituted by set_kinematics()
+    bool symbolic_kinematics;
+    // the kinematic invariants among the Kira variables
+    GiNaC::lst kinematic_variables;
+    // a term factor * coefficient of an IBP relation read with symbolic
+    // kinematics, where the coefficient is rational in d and the
+    // kinematic invariants
+    struct symbolic_term {
+        GiNaC::ex factor;
+        compiled_rational coefficient;
+    };
+    integral_map<std::vector<symbolic_term>> symbolic_relations;
+    // whether IBP relations are expanded by modular_expander
+    bool modular_expansion;
+    std::vector<integral_symtab> numeric_integral_table;
+    // I[...] -> {I[...]_0, I[...]_1, ...}
+    std::map<GiNaC::ex, GiNaC::lst, GiNaC::ex_is_less> integral_expansions;
+    std::vector<integral_map<linear_form>> numeric_ibp_table;
+    GiNaC::lst unknown_list;
+    unknown_index unknown_indices;
     GiNaC::lst master_values;
-    std::vector<std::string> effective_master_table;
+    std::vector<integral_index> effective_master_table;
 
     GiNaC::lst substitution_rules;
     GiNaC::lst propagators;
 
     GiNaC::lst feynman_params;
     std::vector<int> effective_feynman_params;
+    // L = log(U^{L+1}/F^L) in the ansatze
+    GiNaC::symbol log_symbol;
     GiNaC::ex symanzik_U;
     GiNaC::ex symanzik_F;
 
@@ -144,38 +231,74 @@ private:
     void read_propagators();
     void read_symbols();
     void read_kinematics_numerics();
+    void read_kinematics_scan();
+    void substitute_kinematics();
     void read_masters();
     void compute_symanzik();
     void read_master_values();
-    void count_ibps();
+#ifndef NO_GSL
+    /**
+     * Minimize F, and extremize U^{L+1}/F^L, on the simplex starting
+     * from the results of random sampling, after checking F at the
+     * centroids of the faces of the simplex.
+     * @param numeric_F F with numeric kinematics
+     * @param params the effective Feynman parameters
+     * @param min_F_point the random sample with the smallest F
+     */
+    bool minimize_euclidean(const GiNaC::ex& numeric_F, const GiNaC::lst& params,
+                            const std::vector<double>& min_F_point);
+#endif // NO_GSL
 
     // cache management
     std::string cache_dir;
-    bool read_cache_exists(const std::string& key, const std::string& integral);
-    GiNaC::ex load_from_read_cache(const std::string& key, const std::string& integral);
-    void save_to_read_cache(const std::string& key, const std::string& integral, const GiNaC::ex& coefficient);
-    GiNaC::ex read_ibp_simple(const std::string& key, const std::string& integral);
-    bool expand_cache_exists(const std::string& key);
-    GiNaC::ex load_from_expand_cache(const std::string& key);
-    void save_to_expand_cache(const std::string& key, const GiNaC::ex& coefficient);
-    GiNaC::matrix load_from_generate_cache(int integral, int block, time_t timestamp);
-    void save_to_generate_cache(int integral, int block, time_t timestamp, const GiNaC::matrix& matrix);
+    cache_store read_cache;
+    cache_store expand_cache;
+    std::string read_namespace;
+    // whether caches are kept under `cache_dir`, or in memory only
+    bool use_cache;
+    void open_caches();
+    void open_expand_cache(int order);
+    std::uint64_t kira_file_hash();
+    bool read_cache_exists(const integral_index& key, const integral_index& integral);
+    GiNaC::ex load_from_read_cache(const integral_index& key, const integral_index& integral);
+    void save_to_read_cache(const integral_index& key, const integral_index& integral, const std::string& coefficient);
+    GiNaC::ex read_ibp_simple(const integral_index& key, const integral_index& integral);
+    // Kira stores coefficients of integrals moved to the other side
+    int ibp_sign(const integral_index& key, const integral_index& integral) {
+        int n_indices = key.size();
+        int sum_diff = 0;
+        for (int i = 0; i < n_indices; i++)
+            sum_diff += (key[i] - integral[i]);
+        return (sum_diff % 2 == 0) ? 1 : -1;
+    }
+    bool expand_cache_exists(const integral_index& key);
+    std::vector<linear_form> load_from_expand_cache(const integral_index& key);
+    void save_to_expand_cache(const integral_index& key, const std::string& coefficient);
 
     // subprocess management
     int max_subprocesses;
-    int working_subprocesses;
-    std::map<pid_t, std::pair<std::string, std::string>> read_subprocess_map;
-    std::map<pid_t, std::string> expand_subprocess_map;
-    std::map<pid_t, std::pair<int, int>> generate_subprocess_map;
-    void read_subprocess_work(const std::string& key, const std::string& integral, const std::string& coefficient);
-    void read_mainprocess_work(const std::string& key, const std::string& integral);
-    void read_subprocess_yield(bool always_wait, const std::function<void(const std::string&, const std::string&)>& callback);
-    void expand_subprocess_work(const std::string& key, const GiNaC::ex& coefficient, const GiNaC::lst& rules, int order, const GiNaC::symbol& eps);
-    void expand_mainprocess_work(const std::string& key);
+    // long-lived workers, forked anew at the start of each stage so that
+    // they see the inputs of that stage
+    worker_pool workers;
+    // coefficients of up to `read_batch_size` IBP relations are parsed
+    // by one job
+    int read_batch_size;
+    int read_batch_relations;
+    typedef std::function<void(const integral_index&, const integral_index&)> read_callback;
+    std::vector<std::pair<integral_index, integral_index>> read_batch;
+    std::vector<std::string> read_batch_coefficients;
+    std::map<int, std::vector<std::pair<integral_index, integral_index>>> read_subprocess_map;
+    std::map<int, integral_index> expand_subprocess_map;
+    void read_subprocess_start();
+    void read_subprocess_work(const integral_index& key, const integral_index& integral, const std::string& coefficient);
+    void read_subprocess_next_relation(const read_callback& callback);
+    void read_subprocess_submit(const read_callback& callback);
+    void read_mainprocess_work(const integral_index& key, const integral_index& integral);
+    void read_subprocess_yield(bool always_wait, const read_callback& callback);
+    void expand_subprocess_start(const std::map<GiNaC::ex, GiNaC::lst, GiNaC::ex_is_less>& expansions, int order);
+    void expand_subprocess_work(const integral_index& key);
+    void expand_mainprocess_work(const integral_index& key);
     void expand_subprocess_yield(bool always_wait);
-    void generate_subprocess_work(int integral, int block, time_t timestamp, const GiNaC::matrix& raw_matrix, const GiNaC::lst& rules, const GiNaC::symbol& integral_symbol);
-    void generate_mainprocess_work(int integral, int block, time_t timestamp, std::vector<std::vector<GiNaC::matrix>>* coefficient, std::vector<GiNaC::matrix>* bias);
-    void generate_subprocess_yield(bool always_wait, time_t timestamp, std::vector<std::vector<GiNaC::matrix>>* coefficient, std::vector<GiNaC::matrix>* bias);
 
     GiNaC::ex get(GiNaC::symtab& _table, const std::string& _key,
                   const std::string& _prefix = "", 
@@ -186,10 +309,23 @@ private:
         return _table[_key];
     }
 
-    std::string int_to_id(const std::string& _integral) {
-        std::size_t start = _integral.find('[') + 1,
-                    end = _integral.find(']');
-        return _integral.substr(start, end - start);
+    // the same, for integrals named e.g. "I[2,2,2,0]"
+    GiNaC::ex get(integral_symtab& _table, const integral_index& _key,
+                  const std::string& _prefix = "",
+                  const std::string& _suffix = "") {
+        auto it = _table.find(_key);
+        if (it == _table.end())
+            it = _table.emplace(_key, GiNaC::symbol(_prefix + _key.to_string() + _suffix)).first;
+        return it->second;
+    }
+
+    // kinematics substituted while reading IBP relations
+    GiNaC::lst read_stage_numerics() {
+        return symbolic_kinematics ? GiNaC::lst() : kinematics_numerics;
+    }
+
+    integral_index int_to_id(std::string_view _integral) {
+        return integral_index::parse(_integral);
     }
 
     void put_raw_symbols(const std::vector<std::string>& _keys) {
@@ -197,9 +333,9 @@ private:
             get(symbol_table, key);
     }
 
-    GiNaC::symtab poly_to_terms(const std::string& base_indices, const GiNaC::ex& polynomial, GiNaC::symtab* record) {
-        GiNaC::symtab result;
-        auto indices = split(base_indices.c_str());
+    integral_symtab poly_to_terms(const integral_index& base_indices, const GiNaC::ex& polynomial, integral_symtab* record) {
+        integral_symtab result;
+        auto indices = base_indices.to_vector();
         auto termp = polynomial_iterator(polynomial), end = termp.end();
         for (; termp != end; ++termp) {
             std::vector<int> new_indices(feynman_params.nops(), 0);
@@ -214,7 +350,7 @@ private:
                 }
             }
             factor *= term;
-            auto repr = combine(new_indices);
+            integral_index repr(new_indices);
             result[repr] = factor;
             if (record != nullptr)
                 (*record)[repr] = 0;
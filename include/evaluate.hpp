@@ -0,0 +1,156 @@
+#ifndef EVALUATE_HPP
+#define EVALUATE_HPP
+
+#include <ginac/ginac.h>
+#include <vector>
+
+// A polynomial with numeric coefficients, compiled into a straight-line
+// program that evaluates it in nested Horner form, one variable after
+// another, e.g.
+//
+//      3 x^2 y + 2 x^2 + y + 5  ->  (3 y + 2) x^2 + (y + 5),
+//
+// so that every power of a variable is applied once per group of terms
+// sharing it, rather than once per term.
+class horner_program {
+public:
+    horner_program() : num_vars(0), max_degree(0), max_depth(0) { }
+
+    /**
+     * Compile a polynomial.
+     * @param polynomial the polynomial, whose coefficients are numeric
+     * once expanded in `vars`
+     * @param vars the variables
+     */
+    horner_program(const GiNaC::ex& polynomial, const GiNaC::lst& vars);
+
+    int variables() const {
+        return num_vars;
+    }
+
+    // the highest power of any variable
+    int degree() const {
+        return max_degree;
+    }
+
+    /**
+     * Evaluate at a batch of points.
+     * @param powers powers[(v * stride + k) * count + p] = x_v^k at point p,
+     * for k = 0, ..., degree()
+     * @param stride at least degree() + 1
+     * @param count number of points
+     * @param values receives the `count` values
+     */
+    void evaluate(const double* powers, std::size_t stride, std::size_t count, double* values) const;
+
+    /**
+     * Evaluate at a single point, without allocating.
+     * @param x x[0], ..., x[variables() - 1]
+     */
+    double evaluate(const double* x) const;
+
+    /**
+     * Evaluate exactly at a single point.
+     * @param powers powers[v][k] = x_v^k, for k = 0, ..., degree()
+     */
+    GiNaC::numeric evaluate(const std::vector<std::vector<GiNaC::numeric>>& powers) const;
+
+private:
+    enum opcode {
+        push_constant,  // push constants[arg]
+        multiply_power, // multiply the top by x_var^arg
+        add_top         // pop the top and add it to the new top
+    };
+    struct instruction {
+        opcode op;
+        int var;
+        int arg;
+    };
+    int num_vars;
+    int max_degree;
+    int max_depth;
+    std::vector<instruction> program;
+    std::vector<GiNaC::numeric> constants;
+    std::vector<double> double_constants;
+    // stack of the single-point evaluation, allocated once
+    mutable std::vector<double> stack_buffer;
+
+    struct term {
+        std::vector<int> exponents;
+        GiNaC::numeric coefficient;
+    };
+    void emit(const std::vector<term>& terms, std::size_t begin, std::size_t end, int var, int depth);
+};
+
+// A polynomial with numeric coefficients, compiled so that evaluating it
+// costs a few multiplications per group of terms instead of a symbolic
+// substitution.
+class compiled_polynomial {
+public:
+    compiled_polynomial() { }
+
+    /**
+     * Compile a polynomial.
+     * @param polynomial the polynomial, whose coefficients are numeric
+     * once expanded in `vars`
+     * @param vars the variables
+     */
+    compiled_polynomial(const GiNaC::ex& polynomial, const GiNaC::lst& vars)
+        : program(polynomial, vars) { }
+
+    int variables() const {
+        return program.variables();
+    }
+
+    // evaluate at a single point x[0], ..., x[variables() - 1]
+    double operator()(const double* x) const;
+
+    /**
+     * Evaluate at a batch of points.
+     * @param points `count` points, stored one after another
+     * @param count number of points
+     * @param values receives the `count` values
+     */
+    void evaluate(const double* points, std::size_t count, double* values) const;
+
+private:
+    horner_program program;
+};
+
+// A rational function of a variable x and some parameters. The expanded
+// numerator and denominator are split by powers of x, and the coefficient
+// of every power is compiled into a Horner program of the parameters.
+// Substituting numeric parameters then gives a rational function of x at
+// the cost of a few exact multiplications per group of terms, instead of
+// a symbolic substitution followed by simplification.
+class compiled_rational {
+public:
+    compiled_rational() : num_params(0), max_degree(0) { }
+
+    /**
+     * Compile a rational function.
+     * @param numerator expanded numerator, a polynomial in x and `params`
+     * @param denominator expanded denominator, likewise
+     * @param x the variable that stays symbolic
+     * @param params the parameters
+     */
+    compiled_rational(const GiNaC::ex& numerator, const GiNaC::ex& denominator,
+                      const GiNaC::symbol& x, const GiNaC::lst& params);
+
+    // the constant 1, which depends on no parameter
+    static compiled_rational one();
+
+    // the rational function of x at parameters values[0], ..., values[n - 1]
+    GiNaC::ex operator()(const std::vector<GiNaC::numeric>& values) const;
+
+private:
+    GiNaC::ex x;
+    int num_params;
+    // the highest power of any parameter
+    int max_degree;
+    // coefficients of x^0, x^1, ... in the numerator and the denominator
+    std::vector<horner_program> numerator;
+    std::vector<horner_program> denominator;
+};
+
+#endif // EVALUATE_HPP
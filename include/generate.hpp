@@ -4,6 +4,17 @@
 #include <ginac/ginac.h>
 #include <yaml-cpp/yaml.h>
 
+// The quadratic form of \{c_k\}
+//
+//      prefactor * (c_0 terms[0] + c_1 terms[1] + ...)^2,
+//
+// i.e. the symmetric matrix with entries prefactor * terms[k] * terms[l],
+// kept in factored form.
+struct quadratic_form {
+    GiNaC::ex prefactor;
+    std::vector<GiNaC::ex> terms;
+};
+
 class polynomial_generator {
 public:
     polynomial_generator(const GiNaC::lst& feynman_params,
@@ -35,9 +46,9 @@ public:
      * @param prefactor a prefactor
      * @param terms a list of terms to be fully squared
      * 
-     * @returns a symmetric square matrix representing the quadratic form
+     * @returns the quadratic form
      */
-    GiNaC::matrix generate(const std::string& prefactor, const std::vector<std::string>& terms);
+    quadratic_form generate(const std::string& prefactor, const std::vector<std::string>& terms);
     /**
      * Generate a quadratic form of \{c_k\} of the following content:
      * 
@@ -54,11 +65,11 @@ public:
      * @param max_x_degree max degree in the Feynman parameters
      * @param max_log_degree max degree in L = log(U^{L+1}/F^L)
      * 
-     * @returns a symmetric square matrix representing the quadratic form
+     * @returns the quadratic form
      */
-    GiNaC::matrix generate(const std::string& prefactor, int min_x_degree, int max_x_degree, int max_log_degree);
+    quadratic_form generate(const std::string& prefactor, int min_x_degree, int max_x_degree, int max_log_degree);
     
-    std::vector<GiNaC::matrix> generate_from_config();
+    std::vector<quadratic_form> generate_from_config();
 private:
     GiNaC::symtab symbol_table;
     GiNaC::parser* parser;
@@ -0,0 +1,102 @@
+#ifndef INDEX_HPP
+#define INDEX_HPP
+
+#include <ginac/ginac.h>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+// Indices (a_1, ..., a_n) of a Feynman integral with n <= 15, packed as
+// signed bytes into two 64-bit words whose last byte holds n. Keys are
+// thus compared and hashed as two integers rather than as strings like
+// "2,2,2,0,0,0,0,0,0". Families with more propagators and ISPs are
+// rejected when the configure file is read.
+class integral_index {
+public:
+    static const int max_size = 15;
+
+    integral_index() : words{0, 0} { }
+    integral_index(const std::vector<int>& indices);
+
+    /**
+     * Parse indices "a_1,...,a_n", optionally enclosed as in
+     * "family[a_1,...,a_n]".
+     */
+    static integral_index parse(std::string_view str);
+
+    int size() const {
+        return slot(max_size);
+    }
+
+    int operator[](int i) const {
+        return (std::int8_t)slot(i);
+    }
+
+    std::vector<int> to_vector() const;
+    // "a_1,...,a_n"
+    std::string to_string() const;
+
+    // the 16 packed bytes, e.g. for cache keys and job payloads
+    std::string raw() const;
+    static integral_index from_raw(std::string_view raw);
+
+    bool operator==(const integral_index& other) const {
+        return words[0] == other.words[0] && words[1] == other.words[1];
+    }
+
+    bool operator!=(const integral_index& other) const {
+        return !(*this == other);
+    }
+
+    bool operator<(const integral_index& other) const {
+        return words[0] < other.words[0]
+            || (words[0] == other.words[0] && words[1] < other.words[1]);
+    }
+
+    std::size_t hash() const {
+        std::uint64_t h = words[0] * 0x9e3779b97f4a7c15ULL;
+        h ^= words[1] + 0x7f4a7c159e3779b9ULL + (h << 6) + (h >> 2);
+        return h ^ (h >> 31);
+    }
+
+private:
+    std::uint64_t words[2];
+
+    unsigned slot(int i) const {
+        return (words[i / 8] >> (i % 8 * 8)) & 0xff;
+    }
+
+    void set_slot(int i, unsigned value) {
+        words[i / 8] &= ~((std::uint64_t)0xff << (i % 8 * 8));
+        words[i / 8] |= (std::uint64_t)(value & 0xff) << (i % 8 * 8);
+    }
+};
+
+struct integral_index_hash {
+    std::size_t operator()(const integral_index& index) const {
+        return index.hash();
+    }
+};
+
+template <typename T>
+using integral_map = std::unordered_map<integral_index, T, integral_index_hash>;
+
+// integral indices -> expressions, in place of GiNaC::symtab
+typedef integral_map<GiNaC::ex> integral_symtab;
+
+// the keys of a map in ascending order, for output that does not depend
+// on the hash table layout
+template <typename T>
+std::vector<integral_index> sorted_keys(const integral_map<T>& map) {
+    std::vector<integral_index> keys;
+    keys.reserve(map.size());
+    for (auto& key_value: map)
+        keys.push_back(key_value.first);
+    std::sort(keys.begin(), keys.end());
+    return keys;
+}
+
+#endif // INDEX_HPP
@@ -0,0 +1,71 @@
+#ifndef KIRA_HPP
+#define KIRA_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A whitespace-delimited token of a Kira reduction result that mentions
+// the integral family. It is either the head of an IBP relation, e.g.
+// `banana[1,1,1,1,0,0,0,0,0]`, or a body term of the form
+// `banana[2,1,1,1,0,0,0,0,0]*(coefficient)`.
+struct kira_record {
+    bool head;
+    std::string_view integral;
+    std::string_view coefficient;
+};
+
+class kira_reader {
+public:
+    /**
+     * Map a Kira reduction result into memory and tokenize it into
+     * head/body records in a single pass.
+     * @param filename Kira reduction result file name
+     * @param integral_family name of the family of integrals
+     */
+    kira_reader(const std::string& filename, const std::string& integral_family);
+    ~kira_reader();
+
+    kira_reader(const kira_reader&) = delete;
+    kira_reader& operator=(const kira_reader&) = delete;
+
+    std::size_t num_records() const {
+        return records.size();
+    }
+
+    // number of IBP relations, i.e. of head records
+    std::size_t num_heads() const {
+        return heads;
+    }
+
+    kira_record operator[](std::size_t i) const {
+        auto& r = records[i];
+        std::string_view token(data + r.offset, r.length);
+        if (r.asterisk == head_mark)
+            return kira_record{true, token, std::string_view()};
+        return kira_record{false, token.substr(0, r.asterisk), token.substr(r.asterisk + 1)};
+    }
+
+private:
+    // records are kept as offsets into the mapping, so that multi-GB
+    // results cost 16 bytes per term on top of the page cache
+    struct packed_record {
+        std::uint64_t offset;
+        std::uint32_t length;
+        std::uint32_t asterisk;
+    };
+    static constexpr std::uint32_t head_mark = UINT32_MAX;
+
+    const char* data;
+    std::size_t size;
+    bool mapped;
+    // fallback storage if the file cannot be mapped
+    std::string buffer;
+    std::vector<packed_record> records;
+    std::size_t heads;
+
+    void tokenize(const std::string& integral_family);
+};
+
+#endif // KIRA_HPP
@@ -0,0 +1,59 @@
+#ifndef LINEAR_HPP
+#define LINEAR_HPP
+
+#include <ginac/ginac.h>
+#include <stdexcept>
+#include "packed.hpp"
+
+// A sparse linear combination
+//
+//      constant + values[0] x[indices[0]] + values[1] x[indices[1]] + ...
+//
+// of the unknowns x, i.e. the master integrals I[...]_k to be solved for,
+// with strictly increasing indices. The constant collects the
+// contributions of master integrals with known values.
+struct linear_form {
+    linear_form() : constant(0) { }
+
+    std::vector<int> indices;
+    std::vector<GiNaC::numeric> values;
+    GiNaC::ex constant;
+
+    // *this += factor * other
+    void axpy(const GiNaC::numeric& factor, const linear_form& other);
+
+    /**
+     * Convert back to an expression.
+     * @param unknowns list of unknowns, indexed as in `indices`
+     */
+    GiNaC::ex to_ex(const GiNaC::lst& unknowns) const;
+
+    // flatten into {{indices}, {values}, constant}
+    GiNaC::ex to_lst() const;
+    static linear_form from_lst(const GiNaC::ex& lst);
+};
+
+// a symmetric matrix of linear forms
+typedef packed_symmetric<linear_form> linear_block;
+
+// maps every unknown to its index
+typedef std::map<GiNaC::ex, int, GiNaC::ex_is_less> unknown_index;
+
+// thrown when an expression is not linear in the unknowns with numeric
+// coefficients
+class linear_form_error : public std::runtime_error {
+public:
+    linear_form_error(const std::string& what) : std::runtime_error(what) { }
+};
+
+/**
+ * Collect a linear combination of unknowns into a sparse form.
+ * Coefficients are kept exact, so that one that is not numeric, e.g.
+ * sqrt(2), throws linear_form_error rather than being evaluated. So do
+ * terms that are not linear in the unknowns, e.g. x[0]^2.
+ * @param ex the expression, linear in the unknowns with numeric coefficients
+ * @param index maps every unknown to its index
+ */
+linear_form to_linear_form(const GiNaC::ex& ex, const unknown_index& index);
+
+#endif // LINEAR_HPP
@@ -0,0 +1,94 @@
+#ifndef MODULAR_HPP
+#define MODULAR_HPP
+
+#include <ginac/ginac.h>
+#include <cstdint>
+#include "linear.hpp"
+#include "series.hpp"
+
+// A truncated Laurent series in eps with coefficients modulo a prime p,
+//
+//      c[0] eps^v + c[1] eps^(v+1) + ... + O(eps^(v+n)),
+//
+// laid out as eps_series.
+struct modular_series {
+    int valuation;
+    std::vector<std::uint64_t> coefficients;
+
+    int precision() const {
+        return valuation + (int)coefficients.size();
+    }
+
+    // coefficient of eps^power
+    std::uint64_t operator[](int power) const {
+        int i = power - valuation;
+        if (i < 0 || i >= (int)coefficients.size())
+            return 0;
+        return coefficients[i];
+    }
+};
+
+// Expands IBP relations in d = d0 - 2 eps like eps_expander, but computes
+// the coefficients of the master integrals modulo several 63-bit primes
+// in native integer arithmetic, and reconstructs the exact rationals by
+// Chinese remaindering and rational reconstruction. Primes are added
+// until the reconstruction no longer changes.
+//
+// Only terms `coefficient * I` are handled this way, where I stands for
+// an expansion and the coefficient is a rational function of d with
+// rational numbers. The remaining terms, e.g. known master integrals
+// with Gamma functions, are expanded by eps_expander.
+class modular_expander {
+public:
+    /**
+     * @param d the spacetime dimension symbol
+     * @param d0 target spacetime dimension
+     * @param expansions symbols standing for the polynomials in eps given
+     * by their coefficients, e.g. I[...] -> {I[...]_0, I[...]_1, ...}
+     */
+    modular_expander(const GiNaC::symbol& d, int d0,
+                     const std::map<GiNaC::ex, GiNaC::lst, GiNaC::ex_is_less>& expansions)
+        : d(d), d0(d0), expansions(expansions), fallback(d, d0, expansions) { }
+
+    /**
+     * Compute the Taylor coefficients of an IBP relation up to eps^order.
+     * @param f the IBP relation
+     * @param order expansion order
+     * @param indices maps every unknown to its index
+     * @param forms output, the coefficients of eps^0, ..., eps^order
+     * @returns false if `f` has a pole at eps = 0
+     */
+    bool expand(const GiNaC::ex& f, int order, const unknown_index& indices,
+                std::vector<linear_form>& forms);
+
+private:
+    GiNaC::symbol d;
+    int d0;
+    std::map<GiNaC::ex, GiNaC::lst, GiNaC::ex_is_less> expansions;
+    eps_expander fallback;
+
+    // thrown when the prime divides a denominator
+    struct bad_prime { };
+    // thrown when the result modulo the prime is not conclusive
+    struct inconclusive { };
+
+    // whether `f` is a rational function of d with rational numbers
+    bool is_rational(const GiNaC::ex& f);
+    modular_series evaluate(const GiNaC::ex& f, int n, std::uint64_t p);
+
+    /**
+     * Expand the coefficients of the expansions modulo a prime.
+     * @param terms the coefficients of every expansion
+     * @param n number of terms of the series
+     * @param p the prime
+     * @returns the series of every expansion, with no negative powers of eps
+     * except for leading coefficients that do not vanish modulo p
+     */
+    std::vector<modular_series> expand_terms(const std::vector<std::pair<GiNaC::ex, GiNaC::ex>>& terms,
+                                             int n, std::uint64_t p);
+    // expand all of `f` with eps_expander
+    bool expand_exactly(const GiNaC::ex& f, int order, const unknown_index& indices,
+                        std::vector<linear_form>& forms);
+};
+
+#endif // MODULAR_HPP
@@ -0,0 +1,60 @@
+#ifndef PACKED_HPP
+#define PACKED_HPP
+
+#include <ginac/ginac.h>
+#include <utility>
+#include <vector>
+
+// A symmetric n x n matrix, of which only the entries (i, j) with i <= j
+// are stored, packed row by row:
+//
+//      (0, 0), (0, 1), ..., (0, n-1), (1, 1), ..., (1, n-1), ..., (n-1, n-1)
+//
+// Both (i, j) and (j, i) refer to the same entry.
+template <typename T>
+class packed_symmetric {
+public:
+    packed_symmetric(int n = 0) : n(n), entries(n * (n + 1) / 2) { }
+
+    int size() const {
+        return n;
+    }
+
+    T& operator()(int i, int j) {
+        return entries[index(i, j)];
+    }
+
+    const T& operator()(int i, int j) const {
+        return entries[index(i, j)];
+    }
+
+    // position of (i, i) in packed order, so that rows [i, k) occupy
+    // [row_begin(i), row_begin(k)); row_begin(n) is the number of entries
+    std::size_t row_begin(int i) const {
+        return (std::size_t)i * n - (std::size_t)i * (i - 1) / 2;
+    }
+
+    // entries in packed order
+    std::vector<T>& packed() {
+        return entries;
+    }
+
+    const std::vector<T>& packed() const {
+        return entries;
+    }
+
+private:
+    int n;
+    std::vector<T> entries;
+
+    std::size_t index(int i, int j) const {
+        if (i > j)
+            std::swap(i, j);
+        return (std::size_t)i * n - (std::size_t)i * (i - 1) / 2 + (j - i);
+    }
+};
+
+// a symmetric matrix of expressions
+typedef packed_symmetric<GiNaC::ex> symmetric_matrix;
+
+#endif // PACKED_HPP
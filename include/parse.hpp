@@ -2,20 +2,51 @@
 #define PARSE_HPP
 
 #include <ginac/ginac.h>
+#include <cstdint>
+#include <unordered_map>
 #include "generate.hpp"
+#include "linear.hpp"
+#include "index.hpp"
+
+// Exponents of the effective Feynman parameters and of L, packed into
+// 8-bit slots, so that multiplying monomials amounts to adding keys.
+struct monomial_key {
+    std::uint64_t words[2];
+
+    bool operator==(const monomial_key& other) const {
+        return words[0] == other.words[0] && words[1] == other.words[1];
+    }
+
+    monomial_key operator+(const monomial_key& other) const {
+        return monomial_key{{words[0] + other.words[0], words[1] + other.words[1]}};
+    }
+};
+
+struct monomial_key_hash {
+    std::size_t operator()(const monomial_key& key) const {
+        std::uint64_t h = key.words[0] * 0x9e3779b97f4a7c15ULL;
+        return h ^ (key.words[1] + 0x7f4a7c159e3779b9ULL + (h << 6) + (h >> 2));
+    }
+};
+
+// a polynomial as a list of monomials with their coefficients
+typedef std::vector<std::pair<monomial_key, GiNaC::numeric>> monomial_list;
 
 class polynomial_parser {
 public:
-    polynomial_parser(const std::vector<std::string>& effective_master_table,
-                      std::vector<GiNaC::symtab>& numeric_ibp_table,
+    polynomial_parser(const std::vector<integral_index>& effective_master_table,
+                      std::vector<integral_map<linear_form>>& numeric_ibp_table,
                       const std::vector<int>& effective_feynman_params,
                       const GiNaC::lst& feynman_params,
-                      const YAML::Node& config)
+                      const GiNaC::symbol& _L,
+                      const YAML::Node& config,
+                      int max_subprocesses = 1)
         : effective_master_tablep(&effective_master_table),
           numeric_ibp_tablep(&numeric_ibp_table),
           effective_feynman_paramsp(&effective_feynman_params),
           feynman_paramsp(&feynman_params),
-          configp(&config), L("L") { }
+          configp(&config), max_subprocesses(max_subprocesses),
+          L(_L), lookup_table_built(false) { }
 
     /**
      * Parse a polynomial of Feynman parameters (\{x_i\}) and
@@ -23,13 +54,30 @@ public:
      * 
      * @param polynomial the input polynomial whose arguments are 
      * Feynman parameters (\{x_i\}) and L = log(U^{L+1}/F^L)
-     * @param matrix_input boolean flag indicating whether the input is
-     * a matrix of polynomials (true) or a single polynomial (false)
      * 
      * @returns a `bool` value indicating whether parsing succeeds, and
      * the parsing result (if it does succeed)
      */
-    std::pair<bool, GiNaC::ex> parse(const GiNaC::ex& polynomial, bool matrix_input);
+    std::pair<bool, linear_form> parse(const GiNaC::ex& polynomial);
+    /**
+     * Parse the entries prefactor * terms[k] * terms[l] (k <= l) of a
+     * quadratic form, from sums of the exponents of their factors.
+     * 
+     * @param form the input quadratic form
+     * 
+     * @returns a `bool` value indicating whether parsing succeeds, and
+     * the parsing result (if it does succeed)
+     */
+    std::pair<bool, linear_block> parse(const quadratic_form& form);
+    /**
+     * Parse a list of quadratic forms, with rows of all of them spread
+     * across up to `max_subprocesses` workers.
+     * 
+     * @param forms the input quadratic forms
+     * 
+     * @returns the forms that are parsed successfully, in input order
+     */
+    std::vector<linear_block> parse(const std::vector<quadratic_form>& forms);
     
     // Export internal data to a polynomial generator.
     polynomial_generator get_polynomial_generator() {
@@ -39,14 +87,33 @@ public:
     }
 private:
     // these five pointers are owned by someone else
-    const std::vector<std::string>* effective_master_tablep;
-    std::vector<GiNaC::symtab>* numeric_ibp_tablep;
+    const std::vector<integral_index>* effective_master_tablep;
+    std::vector<integral_map<linear_form>>* numeric_ibp_tablep;
     const std::vector<int>* effective_feynman_paramsp;
     const GiNaC::lst* feynman_paramsp;
     const YAML::Node* configp;
+    int max_subprocesses;
 
-    // "L" represents log(U^{L+1}/F^L)
+    // "L" represents log(U^{L+1}/F^L); it is shared by all parsers of a
+    // config, so that ansatze generated by one are parsed by another
     GiNaC::symbol L;
+
+    // maps the monomial prod_i x_i^{a_i - 1} L^k to the expanded IBP
+    // numeric_ibp_table[k][a], scaled by k!
+    struct ibp_entry {
+        const linear_form* form;
+        GiNaC::numeric factor;
+    };
+    std::unordered_map<monomial_key, ibp_entry, monomial_key_hash> lookup_table;
+    bool lookup_table_built;
+    void build_lookup_table();
+
+    monomial_key make_key(const std::vector<int>& exponents);
+    GiNaC::ex monomial(const monomial_key& key);
+    bool to_monomials(const GiNaC::ex& polynomial, monomial_list& monomials);
+    bool accumulate(const monomial_key& key, const GiNaC::numeric& coefficient, linear_form& result);
+    // fill in the rows [begin, end) of `result`
+    bool parse_rows(const quadratic_form& form, int begin, int end, linear_block& result);
 };
 
 
@@ -0,0 +1,71 @@
+#ifndef POOL_HPP
+#define POOL_HPP
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+#include <sys/types.h>
+
+// A pool of long-lived worker processes. Jobs and results are serialized
+// strings exchanged over pipes, so the per-job cost is a few system calls
+// instead of a fork() and a waitpid().
+class worker_pool {
+public:
+    // maps a serialized job to a serialized result, run in the workers
+    typedef std::function<std::string(const std::string&)> handler;
+
+    worker_pool() : num_busy(0) { }
+    ~worker_pool() {
+        stop();
+    }
+
+    worker_pool(const worker_pool&) = delete;
+    worker_pool& operator=(const worker_pool&) = delete;
+
+    /**
+     * Fork `n` workers that run `work` on every job they receive.
+     * Workers see a snapshot of the memory of the calling process at
+     * the time of this call.
+     * @param n number of workers
+     * @param work job handler
+     */
+    void start(int n, const handler& work);
+
+    // Let all workers exit. Outstanding results are discarded.
+    void stop();
+
+    /**
+     * Send a job to an idle worker. Must not be called when `full()`.
+     * @param job serialized job
+     * @returns index of the worker in charge of the job
+     */
+    int submit(const std::string& job);
+
+    /**
+     * Collect finished jobs as (worker index, result) pairs.
+     * @param always_wait whether to block until at least one job finishes;
+     * the call also blocks if all workers are busy
+     */
+    std::vector<std::pair<int, std::string>> collect(bool always_wait);
+
+    int busy() {
+        return num_busy;
+    }
+
+    bool full() {
+        return num_busy == (int)workers.size();
+    }
+
+private:
+    struct worker {
+        pid_t pid;
+        int job_fd;     // written by the main process
+        int result_fd;  // read by the main process
+        bool busy;
+    };
+    std::vector<worker> workers;
+    int num_busy;
+};
+
+#endif // POOL_HPP
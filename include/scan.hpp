@@ -0,0 +1,59 @@
+#ifndef SCAN_HPP
+#define SCAN_HPP
+
+#include <ginac/ginac.h>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "config.hpp"
+#include "generate.hpp"
+
+// outcome of the computation at one kinematic point
+struct point_result {
+    // "solved", "written" (without SDPA), "not_euclidean",
+    // "no_constraints" or "failed"
+    std::string status;
+    // computed master integrals, as I[...]_k == value
+    GiNaC::lst values;
+};
+
+/**
+ * Expand IBPs at the current kinematics, and set up and solve the SDP.
+ * @param configure config whose IBP relations have been read
+ * @param polynomials the ansatze, which do not depend on kinematics
+ * @param warm_start solution to start the SDP from, replaced by the new
+ * solution if one is found
+ */
+point_result solve_point(config_parser& configure,
+                         const std::vector<quadratic_form>& polynomials,
+                         warm_start_point& warm_start);
+
+// Runs all points of `kinematics_scan`. IBP relations are read and the
+// ansatze are generated once, then the points are handed out to worker
+// processes, which share `subprocesses` among them. Every worker visits
+// its points in order, starting each SDP from its previous solution.
+class scan_scheduler {
+public:
+    /**
+     * @param configure config of the scan
+     * @param num_workers number of points computed at the same time
+     */
+    scan_scheduler(config_parser& configure, int num_workers)
+        : configurep(&configure), num_workers(num_workers) { }
+
+    /**
+     * Compute all points, and write a YAML list of per-point records.
+     * @param output path of the output file
+     */
+    void run(const std::filesystem::path& output);
+
+private:
+    config_parser* configurep;
+    int num_workers;
+    std::vector<quadratic_form> polynomials;
+
+    // compute the k-th point, returning its record as YAML
+    std::string solve_scan_point(int k, warm_start_point& warm_start);
+};
+
+#endif // SCAN_HPP
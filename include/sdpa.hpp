@@ -9,6 +9,18 @@
 #endif // NO_SDPA_LIB
 #include <ginac/ginac.h>
 #include <yaml-cpp/yaml.h>
+#include "linear.hpp"
+
+// a non-zero entry (row, col) with row <= col of a block of an SDP
+// constraint matrix, 1-based as in SDPA
+struct sparse_entry {
+    int row;
+    int col;
+    double value;
+};
+
+// the non-zero entries of a block
+typedef std::vector<sparse_entry> sparse_block;
 
 #ifndef NO_SDPA_LIB
 struct sdpa_result {
@@ -19,15 +31,32 @@ struct sdpa_result {
     double primal_err;
     double dual_err;
     std::vector<double> x_vec;
+    // primal and dual matrices, one dense n * n array per block
+    std::vector<std::vector<double>> x_mat;
+    std::vector<std::vector<double>> y_mat;
 };
 
 class sdpa_interface {
 public:
-    sdpa_interface(const std::vector<std::vector<GiNaC::matrix>>& coefficients,
-                   const std::vector<GiNaC::matrix>& bias,
-                   const YAML::Node& config);
+    /**
+     * Set up an SDPA problem.
+     * @param coefficients non-zero entries of the coefficient matrices of
+     * the unknowns, by unknown and block
+     * @param bias non-zero entries of the constant matrices, by block
+     * @param block_sizes size of every block
+     * @param config YAML config
+     * @param warm_start solution of a problem of the same shape to start
+     * from, or nullptr to start from SDPA's default initial point
+     */
+    sdpa_interface(const std::vector<std::vector<sparse_block>>& coefficients,
+                   const std::vector<sparse_block>& bias,
+                   const std::vector<int>& block_sizes,
+                   const YAML::Node& config,
+                   const sdpa_result* warm_start = nullptr);
     void solve();
-    void dump(std::ostream& out);
+    // for debug: write the problem in symbolic form from the blocks it
+    // was assembled from
+    void dump(std::ostream& out, const std::vector<linear_block>& blocks, int num_unknowns);
     ~sdpa_interface();
 
     const sdpa_result& get_result() {
@@ -44,20 +73,20 @@ private:
     sdpa_result result;
     // flag indicating whether error has occurred during initialization
     bool fail;
-    // for debug
-    std::vector<std::vector<std::vector<std::vector<GiNaC::ex>>>> coefficient_matrices;
-    std::vector<std::vector<std::vector<GiNaC::ex>>> bias_matrices;
 };
 
 #else
 
 class sdpa_interface {
 public:
-    sdpa_interface(const std::vector<std::vector<GiNaC::matrix>>& coefficients,
-                   const std::vector<GiNaC::matrix>& bias,
+    sdpa_interface(const std::vector<std::vector<sparse_block>>& coefficients,
+                   const std::vector<sparse_block>& bias,
+                   const std::vector<int>& block_sizes,
                    const YAML::Node& config);
     void solve();
-    void dump(std::ostream& out);
+    // for debug: write the problem in symbolic form from the blocks it
+    // was assembled from
+    void dump(std::ostream& out, const std::vector<linear_block>& blocks, int num_unknowns);
     ~sdpa_interface();
 
     bool get_fail() {
@@ -66,9 +95,6 @@ public:
 private:
     // flag indicating whether error has occurred during initialization
     bool fail;
-    // for debug
-    std::vector<std::vector<std::vector<std::vector<GiNaC::ex>>>> coefficient_matrices;
-    std::vector<std::vector<std::vector<GiNaC::ex>>> bias_matrices;
 };
 
 #endif // NO_SDPA_LIB
@@ -0,0 +1,79 @@
+#ifndef SERIES_HPP
+#define SERIES_HPP
+
+#include <ginac/ginac.h>
+
+// A truncated Laurent series in eps,
+//
+//      c[0] eps^v + c[1] eps^(v+1) + ... + O(eps^(v+n)),
+//
+// where v is the valuation and n = c.size() is the relative precision.
+struct eps_series {
+    int valuation;
+    std::vector<GiNaC::ex> coefficients;
+
+    int precision() const {
+        return valuation + (int)coefficients.size();
+    }
+
+    // coefficient of eps^power
+    GiNaC::ex operator[](int power) const {
+        int i = power - valuation;
+        if (i < 0 || i >= (int)coefficients.size())
+            return 0;
+        return coefficients[i];
+    }
+};
+
+// thrown when a series with no significant non-zero coefficient is inverted
+class eps_series_error : public std::domain_error {
+public:
+    eps_series_error() : std::domain_error("eps_series: division by zero") { }
+};
+
+eps_series operator+(const eps_series& a, const eps_series& b);
+eps_series operator*(const eps_series& a, const eps_series& b);
+eps_series inverse(const eps_series& a);
+eps_series pow(const eps_series& a, int exponent);
+
+// Expands expressions in d = d0 - 2 eps around eps = 0 by evaluating their
+// expression trees in truncated series arithmetic. Rational functions of d
+// thus cost O(size * order^2), instead of the blowup of repeatedly
+// differentiating them. Subtrees that are not rational in d, like the
+// Gamma functions of known master integrals, fall back to GiNaC::series.
+class eps_expander {
+public:
+    /**
+     * @param d the spacetime dimension symbol
+     * @param d0 target spacetime dimension
+     * @param expansions symbols standing for the polynomials in eps given
+     * by their coefficients, e.g. I[...] -> {I[...]_0, I[...]_1, ...}
+     */
+    eps_expander(const GiNaC::symbol& d, int d0,
+                 const std::map<GiNaC::ex, GiNaC::lst, GiNaC::ex_is_less>& expansions)
+        : d(d), d0(d0), expansions(expansions), eps("eps") { }
+
+    /**
+     * Compute the Taylor coefficients of `f` up to eps^order.
+     * @param f the expression to expand
+     * @param order expansion order
+     * @param coefficients output, the coefficients of eps^0, ..., eps^order
+     * @returns false if `f` has a pole at eps = 0
+     */
+    bool expand(const GiNaC::ex& f, int order, std::vector<GiNaC::ex>& coefficients);
+
+private:
+    GiNaC::symbol d;
+    int d0;
+    std::map<GiNaC::ex, GiNaC::lst, GiNaC::ex_is_less> expansions;
+    GiNaC::symbol eps;
+
+    eps_series evaluate(const GiNaC::ex& f, int n);
+    eps_series constant(const GiNaC::ex& c, int n);
+    // split a sum c_0 + c_1 d + c_2 d^2 + ... with numeric c_k by powers
+    // of d; false if `f` is not of this form
+    bool numeric_polynomial(const GiNaC::ex& f, std::vector<GiNaC::numeric>& coefficients);
+    eps_series evaluate_polynomial(const std::vector<GiNaC::numeric>& coefficients, int n);
+};
+
+#endif // SERIES_HPP
@@ -0,0 +1,28 @@
+#ifndef SIMPLEX_HPP
+#define SIMPLEX_HPP
+
+#include <functional>
+#include <limits>
+#include <vector>
+
+// An objective function on the simplex x_i >= 0, x_1 + ... + x_n = 1,
+// returning f(x) and writing its gradient into `gradient`.
+typedef std::function<double(const std::vector<double>& x, std::vector<double>& gradient)> simplex_objective;
+
+// Euclidean projection of `x` onto the simplex.
+void project_to_simplex(std::vector<double>& x);
+
+/**
+ * Locally minimize an objective on the simplex, by projected gradient
+ * descent with backtracking line search.
+ * @param f objective function; NaN or infinite values reject a step
+ * @param x starting point on the simplex, receives the minimizer found
+ * @param max_iterations maximal number of descent steps
+ * @param stop_below stop as soon as f drops below this value
+ * @returns f at the minimizer found
+ */
+double minimize_on_simplex(const simplex_objective& f, std::vector<double>& x,
+                           int max_iterations = 1000,
+                           double stop_below = -std::numeric_limits<double>::infinity());
+
+#endif // SIMPLEX_HPP
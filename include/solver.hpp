@@ -3,11 +3,18 @@
 
 #include <ginac/ginac.h>
 #include <yaml-cpp/yaml.h>
+#include <memory>
+#include "linear.hpp"
+#include "index.hpp"
+
+// solution of an SDP, from which a similar SDP may be started
+struct sdpa_result;
+typedef std::shared_ptr<const sdpa_result> warm_start_point;
 
 class master_solver {
 public:
-    master_solver(const std::vector<std::string>& effective_master_table,
-                  std::vector<GiNaC::symtab>& numeric_integral_table,
+    master_solver(const std::vector<integral_index>& effective_master_table,
+                  std::vector<integral_symtab>& numeric_integral_table,
                   const YAML::Node& config, bool dump)
         : effective_master_tablep(&effective_master_table),
           numeric_integral_tablep(&numeric_integral_table),
@@ -22,7 +29,22 @@ public:
         }
     }
     
-    void solve_from(const std::vector<GiNaC::matrix>& matrices, void* config_parserp);
+    /**
+     * Assemble the SDP from blocks of linear forms and solve it.
+     * @param blocks parsed positivity constraints
+     */
+    void solve_from(const std::vector<linear_block>& blocks);
+
+    // Start the next solve from a previous solution, e.g. that of a
+    // nearby kinematic point. Null means a cold start.
+    void set_warm_start(const warm_start_point& point) {
+        warm_start = point;
+    }
+
+    // the optimal solution found by the last solve, or null
+    const warm_start_point& get_warm_start() {
+        return solution;
+    }
     
 #ifndef NO_SDPA_LIB
     const GiNaC::lst& get_result() {
@@ -34,14 +56,16 @@ public:
     }
 #endif // NO_SDPA_LIB
 private:
-    const std::vector<std::string>* effective_master_tablep;
-    std::vector<GiNaC::symtab>* numeric_integral_tablep;
+    const std::vector<integral_index>* effective_master_tablep;
+    std::vector<integral_symtab>* numeric_integral_tablep;
     const YAML::Node* configp;
 
     GiNaC::lst variables_to_solve;
     GiNaC::lst computed_values;
     bool fail;
     bool will_dump;
+    warm_start_point warm_start;
+    warm_start_point solution;
     const double positivity_threshold = 1e-5;
 };
 
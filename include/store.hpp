@@ -0,0 +1,54 @@
+#ifndef STORE_HPP
+#define STORE_HPP
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+// An append-only key-value store made of two files: `<path>.pack` holds
+// the values back to back, and `<path>.index` maps every key to the
+// (offset, length) of its value in the pack. The index is loaded into
+// memory once, so a lookup is a hash probe followed by a single pread().
+// A store may also live in memory only, for runs that keep no cache.
+class cache_store {
+public:
+    cache_store() : pack_fd(-1), index_fd(-1), pack_size(0), in_memory(false) { }
+    ~cache_store() {
+        close();
+    }
+
+    cache_store(const cache_store&) = delete;
+    cache_store& operator=(const cache_store&) = delete;
+
+    /**
+     * Open (or create) the store and load its index.
+     * @param path path of the store without extension
+     */
+    void open(const std::string& path);
+    // Open an empty store that keeps its values in memory.
+    void open_in_memory();
+    void close();
+
+    bool exists(const std::string& key) const {
+        if (in_memory)
+            return values.find(key) != values.end();
+        return index.find(key) != index.end();
+    }
+
+    std::string load(const std::string& key) const;
+    void save(const std::string& key, const std::string& value);
+
+private:
+    struct location {
+        std::uint64_t offset;
+        std::uint64_t length;
+    };
+    std::unordered_map<std::string, location> index;
+    int pack_fd;
+    int index_fd;
+    std::uint64_t pack_size;
+    bool in_memory;
+    std::unordered_map<std::string, std::string> values;
+};
+
+#endif // STORE_HPP
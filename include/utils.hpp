@@ -7,22 +7,41 @@
 #include <gsl/gsl_rng.h>
 #endif // NO_GSL
 #include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include "index.hpp"
 
 #define START_TIME(description) auto description##_begin = std::chrono::high_resolution_clock::now()
 #define END_TIME(description) auto description##_end = std::chrono::high_resolution_clock::now(); \
     std::chrono::duration<double, std::milli> description##_time_ms = description##_end - description##_begin
 #define PRINT_TIME(description) std::cout << "Takes " << description##_time_ms.count() << " ms on " << #description << "()" << std::endl
 
-std::vector<int> split(const char* str);
-std::string combine(const std::vector<int>& values);
-
 bool has_non_null_key(const YAML::Node& node, const std::string& key);
 
+// directory of logs and dumps, "logs" unless changed, e.g. for one point
+// of a scan; it is created if missing
+std::filesystem::path log_dir();
+void set_log_dir(const std::filesystem::path& path);
+
+// 64-bit non-cryptographic content hashes, used to name cache namespaces
+const std::uint64_t hash_seed = 0xcbf29ce484222325ULL;
+std::uint64_t hash_bytes(const char* data, std::size_t size, std::uint64_t seed = hash_seed);
+std::uint64_t hash_string(const std::string& str, std::uint64_t seed = hash_seed);
+std::uint64_t hash_file(const std::string& filename, std::uint64_t seed = hash_seed);
+std::string to_hex(std::uint64_t value);
+
 double to_double(const GiNaC::ex& ex);
 
+// (de)serialize an expression through a GiNaC archive
+std::string serialize(const GiNaC::ex& ex);
+GiNaC::ex deserialize(const std::string& bytes, const GiNaC::lst& syms);
+// (un)pack a list of strings into a single length-prefixed string
+std::string pack_strings(const std::vector<std::string>& strings);
+std::vector<std::string> unpack_strings(const std::string& packed);
+
 GiNaC::matrix adjugate(const GiNaC::matrix& M);
 
-std::pair<bool, GiNaC::ex> get_prefactor(const std::string& id, int t, int L,
+std::pair<bool, GiNaC::ex> get_prefactor(const integral_index& id, int t, int L,
                                          const GiNaC::ex& d,
                                          bool sector_designate,
                                          std::size_t top_level_sector);
@@ -36,6 +55,8 @@ public:
     random_feynman_params(int n, unsigned long seed = gsl_rng_default_seed);
     ~random_feynman_params();
     void operator()(std::vector<double>& slots);
+    // restart the generator from another seed
+    void seed(unsigned long new_seed);
 private:
     int length;
     std::vector<double> alpha;
@@ -44,25 +44,24 @@ void asy::python_work(char* python_path) {
 
     START_TIME(asy);
     if (pid == 0) { // child
-        std::filesystem::create_directory("logs");
-        int fd = open(std::filesystem::path("logs").append("asy.input").c_str(), 
+        int fd = open(log_dir().append("asy.input").c_str(), 
                       O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
         dup2(fd, STDOUT_FILENO);
         close(fd);
         std::cout << export_to_python() << std::endl;
-        fd = open(std::filesystem::path("logs").append("asy.output").c_str(), 
+        fd = open(log_dir().append("asy.output").c_str(), 
                   O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
         dup2(fd, STDOUT_FILENO);
         close(fd);
         char* const argv[4] = {python_path, (char*)"asy.py", 
-                               (char*)std::filesystem::path("logs").append("asy.input").c_str(), 0};
+                               (char*)log_dir().append("asy.input").c_str(), 0};
         if (execv(python_path, argv) < 0) {
             std::cerr << "Error occurred while executing Python!" << std::endl;
         }
         exit(0);
     } else { // parent
         waitpid(pid, 0, 0);
-        std::ifstream asy_result_file(std::filesystem::path("logs").append("asy.output"));
+        std::ifstream asy_result_file(log_dir().append("asy.output"));
         int row = 0, col = 0;
         asy_result_file >> row >> col;
         if (row > 0 && col > 0) {
@@ -2,94 +2,131 @@
 #include "utils.hpp"
 #include <fstream>
 #include <filesystem>
+#include <sstream>
 
-bool config_parser::read_cache_exists(const std::string& key, const std::string& integral) {
-    return std::filesystem::exists(std::filesystem::path(cache_dir).append("read").append("cache_" + key + "_" + integral));
+// Every stage caches its results in a namespace named after a hash of
+// all inputs of the stage, so that changing e.g. `kinematics_numerics`
+// never reuses stale entries, while unchanged stages are reused across
+// runs. Bump the version tags whenever a stage changes its output.
+static const std::string read_cache_version = "read-2";
+static const std::string expand_cache_version = "expand-4";
+
+static std::string yaml_section(const YAML::Node& node, const std::string& key) {
+    if (!has_non_null_key(node, key))
+        return "";
+    return YAML::Dump(node[key]);
 }
 
-GiNaC::ex config_parser::load_from_read_cache(const std::string& key, const std::string& integral) {
-    GiNaC::lst syms;
-    for (auto& symbol: symbol_table) {
-        syms.append(symbol.second);
+void config_parser::open_caches() {
+    if (!use_cache) {
+        read_cache.open_in_memory();
+        return;
     }
-    
-    GiNaC::archive ar;
-    std::ifstream in(std::filesystem::path(cache_dir).append("read").append("cache_" + key + "_" + integral),
-                     std::ios::binary);
-    in >> ar;
-    in.close();
-    return ar.unarchive_ex(syms, "coeff");
-}
+    std::filesystem::create_directory("tmp");
+    std::filesystem::create_directory(cache_dir);
+    std::filesystem::create_directory(std::filesystem::path(cache_dir).append("read"));
+    std::filesystem::create_directory(std::filesystem::path(cache_dir).append("expand"));
 
-void config_parser::save_to_read_cache(const std::string& key, const std::string& integral, const GiNaC::ex& coefficient) {
-    GiNaC::archive ar;
-    ar.archive_ex(coefficient, "coeff");
-    std::ofstream out(std::filesystem::path(cache_dir).append("read").append("cache_" + key + "_" + integral),
-                      std::ios::binary);
-    out << ar;
-    out.close();
+    std::uint64_t h = hash_string(read_cache_version);
+    h = hash_string(yaml_section(config_file, "integralfamily"), h);
+    // with symbolic kinematics, the read stage is shared by all points
+    if (symbolic_kinematics)
+        h = hash_string("symbolic kinematics", h);
+    else
+        h = hash_string(yaml_section(config_file, "kinematics_numerics"), h);
+    h = hash_string(to_hex(kira_file_hash()), h);
+    read_namespace = to_hex(h);
+    read_cache.open(std::filesystem::path(cache_dir).append("read").append(read_namespace));
+    // SDP blocks are assembled directly from the expanded IBPs, which is
+    // cheaper than caching them
+    std::filesystem::remove_all(std::filesystem::path(cache_dir).append("generate"));
 }
 
-GiNaC::ex config_parser::read_ibp_simple(const std::string& key, const std::string& integral) {
-    auto coefficient = load_from_read_cache(key, integral);
-    auto key_indices = split(key.c_str());
-    auto integral_indices = split(integral.c_str());
-    int n_indices = key_indices.size();
-    int sum_diff = 0;
-    for (int i = 0; i < n_indices; i++) {
-        sum_diff += (key_indices[i] - integral_indices[i]);
+void config_parser::open_expand_cache(int order) {
+    if (!use_cache) {
+        expand_cache.open_in_memory();
+        return;
+    }
+    std::uint64_t h = hash_string(expand_cache_version);
+    h = hash_string(read_namespace, h);
+    if (symbolic_kinematics) {
+        std::ostringstream point;
+        point << kinematics_numerics;
+        h = hash_string(point.str(), h);
     }
-    return coefficient * GiNaC::pow(-1, sum_diff);
+    h = hash_string(yaml_section(config_file, "master_values"), h);
+    h = hash_string(std::to_string(d0) + " " + std::to_string(t) + " " + std::to_string(order), h);
+    // modular reconstruction stops once two primes agree, which is not a
+    // proof, so its results are kept apart from the exact expansions
+    if (modular_expansion)
+        h = hash_string("modular", h);
+    h = hash_file(std::filesystem::path(kira_dir).append("results")
+                  .append(integral_family).append("masters.final"), h);
+    expand_cache.open(std::filesystem::path(cache_dir).append("expand").append(to_hex(h)));
 }
 
-bool config_parser::expand_cache_exists(const std::string& key) {
-    return std::filesystem::exists(std::filesystem::path(cache_dir).append("expand").append("cache_" + key));
+std::uint64_t config_parser::kira_file_hash() {
+    // hashing a multi-GB reduction result costs a full pass, so the hash
+    // is remembered together with the size and modification time
+    auto memo_path = std::filesystem::path(cache_dir).append("kirafile.hash");
+    auto size = std::filesystem::file_size(ibp_result_filename);
+    auto mtime = std::filesystem::last_write_time(ibp_result_filename).time_since_epoch().count();
+
+    std::ifstream memo_in(memo_path);
+    std::string name;
+    std::uintmax_t memo_size;
+    long long memo_mtime;
+    std::string memo_hash;
+    if (std::getline(memo_in, name) && memo_in >> memo_size >> memo_mtime >> memo_hash
+     && name == ibp_result_filename && memo_size == size && memo_mtime == (long long)mtime)
+        return std::stoull(memo_hash, nullptr, 16);
+    memo_in.close();
+
+    std::cerr << "Hashing " << ibp_result_filename << " ..." << std::endl;
+    auto h = hash_file(ibp_result_filename);
+    std::ofstream memo_out(memo_path);
+    memo_out << ibp_result_filename << std::endl
+             << size << " " << (long long)mtime << " " << to_hex(h) << std::endl;
+    return h;
 }
 
+// entries are keyed by the packed indices of the IBP head and integral
+bool config_parser::read_cache_exists(const integral_index& key, const integral_index& integral) {
+    return read_cache.exists(key.raw() + integral.raw());
+}
 
-GiNaC::ex config_parser::load_from_expand_cache(const std::string& key) {
+GiNaC::ex config_parser::load_from_read_cache(const integral_index& key, const integral_index& integral) {
     GiNaC::lst syms;
-    int order = numeric_integral_table.size();
-    for (int i = 0; i < order; i++) {
-        for (auto& name: effective_master_table) {
-            syms.append(numeric_integral_table[i][name]);
-        }
+    for (auto& symbol: symbol_table) {
+        syms.append(symbol.second);
     }
-    
-    GiNaC::archive ar;
-    std::ifstream in(std::filesystem::path(cache_dir).append("expand").append("cache_" + key),
-                     std::ios::binary);
-    in >> ar;
-    in.close();
-    return ar.unarchive_ex(syms, "coeff");
+    return deserialize(read_cache.load(key.raw() + integral.raw()), syms);
 }
 
-void config_parser::save_to_expand_cache(const std::string& key, const GiNaC::ex& coefficient) {
-    GiNaC::archive ar;
-    ar.archive_ex(coefficient, "coeff");
-    std::ofstream out(std::filesystem::path(cache_dir).append("expand").append("cache_" + key),
-                      std::ios::binary);
-    out << ar;
-    out.close();
+void config_parser::save_to_read_cache(const integral_index& key, const integral_index& integral, const std::string& coefficient) {
+    read_cache.save(key.raw() + integral.raw(), coefficient);
 }
 
-GiNaC::matrix config_parser::load_from_generate_cache(int integral, int block, time_t timestamp) {
-    GiNaC::lst syms;
-    GiNaC::archive ar;
-    std::ifstream in(std::filesystem::path(cache_dir).append("generate")
-                     .append("cache_" + std::to_string(integral) + "_" + std::to_string(block) + "_" + std::to_string(timestamp)),
-                     std::ios::binary);
-    in >> ar;
-    in.close();
-    return GiNaC::ex_to<GiNaC::matrix>(ar.unarchive_ex(syms, "coeff"));
+GiNaC::ex config_parser::read_ibp_simple(const integral_index& key, const integral_index& integral) {
+    auto coefficient = load_from_read_cache(key, integral);
+    // with symbolic kinematics, coefficients are cached as lst{numerator, denominator}
+    if (symbolic_kinematics)
+        coefficient = coefficient.op(0) / coefficient.op(1);
+    return coefficient * ibp_sign(key, integral);
+}
+
+bool config_parser::expand_cache_exists(const integral_index& key) {
+    return expand_cache.exists(key.raw());
+}
+
+
+std::vector<linear_form> config_parser::load_from_expand_cache(const integral_index& key) {
+    std::vector<linear_form> forms;
+    for (auto& bytes: unpack_strings(expand_cache.load(key.raw())))
+        forms.push_back(linear_form::from_lst(deserialize(bytes, unknown_list)));
+    return forms;
 }
 
-void config_parser::save_to_generate_cache(int integral, int block, time_t timestamp, const GiNaC::matrix& matrix) {
-    GiNaC::archive ar;
-    ar.archive_ex(matrix, "coeff");
-    std::ofstream out(std::filesystem::path(cache_dir).append("generate")
-                      .append("cache_" + std::to_string(integral) + "_" + std::to_string(block) + "_" + std::to_string(timestamp)),
-                      std::ios::binary);
-    out << ar;
-    out.close();
+void config_parser::save_to_expand_cache(const integral_index& key, const std::string& coefficient) {
+    expand_cache.save(key.raw(), coefficient);
 }
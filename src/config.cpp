@@ -1,9 +1,13 @@
 #include <fstream>
 #include <filesystem>
+#include <unordered_set>
+#include <atomic>
+#include <memory>
+#include <thread>
 #include "utils.hpp"
 #include "config.hpp"
 
-config_parser::config_parser(const char* _config_file_name) {
+config_parser::config_parser(const char* _config_file_name) : log_symbol("L") {
     START_TIME(initialize);
     config_file = YAML::LoadFile(_config_file_name);
     integral_family = config_file["integralfamily"]["name"].as<std::string>();
@@ -28,29 +32,58 @@ config_parser::config_parser(const char* _config_file_name) {
         max_subprocesses = config_file["subprocesses"].as<int>();
     else
         max_subprocesses = 1;
-    working_subprocesses = 0;
-    cache_dir = std::filesystem::path("tmp").append(integral_family);
-    std::filesystem::create_directory("tmp");
-    std::filesystem::create_directory(cache_dir);
-    std::filesystem::create_directory(std::filesystem::path(cache_dir).append("read"));
-    std::filesystem::create_directory(std::filesystem::path(cache_dir).append("expand"));
-    std::filesystem::create_directory(std::filesystem::path(cache_dir).append("generate"));
+    if (has_non_null_key(config_file, "read_batch_size"))
+        read_batch_size = config_file["read_batch_size"].as<int>();
+    else
+        read_batch_size = 1;
+    if (read_batch_size < 1)
+        read_batch_size = 1;
+    if (has_non_null_key(config_file, "scan_workers"))
+        scan_workers = config_file["scan_workers"].as<int>();
+    else
+        scan_workers = 1;
+    if (has_non_null_key(config_file, "scan_output"))
+        scan_output = config_file["scan_output"].as<std::string>();
+    read_batch_relations = 0;
 
     will_check_euclidean = true;
+    will_minimize_euclidean = false;
+    euclidean_trials = 1 << 20;
     will_dump_raw_ibps = false;
     will_dump_expanded_ibps = false;
     will_dump_symbolic_sdp = false;
+    use_cache = true;
+    will_warm_start = true;
+    symbolic_kinematics = false;
+    modular_expansion = false;
     if (has_non_null_key(config_file, "options")) {
         auto options = config_file["options"].as<YAML::Node>();
         if (has_non_null_key(options, "check_euclidean"))
             will_check_euclidean = options["check_euclidean"].as<bool>();
+        if (has_non_null_key(options, "minimize_euclidean"))
+            will_minimize_euclidean = options["minimize_euclidean"].as<bool>();
+        if (has_non_null_key(options, "euclidean_trials"))
+            euclidean_trials = options["euclidean_trials"].as<int>();
         if (has_non_null_key(options, "dump_raw_ibps"))
             will_dump_raw_ibps = options["dump_raw_ibps"].as<bool>();
         if (has_non_null_key(options, "dump_expanded_ibps"))
             will_dump_expanded_ibps = options["dump_expanded_ibps"].as<bool>();
         if (has_non_null_key(options, "dump_symbolic_sdp"))
             will_dump_symbolic_sdp = options["dump_symbolic_sdp"].as<bool>();
+        if (has_non_null_key(options, "use_cache"))
+            use_cache = options["use_cache"].as<bool>();
+        if (has_non_null_key(options, "warm_start"))
+            will_warm_start = options["warm_start"].as<bool>();
+        if (has_non_null_key(options, "symbolic_kinematics"))
+            symbolic_kinematics = options["symbolic_kinematics"].as<bool>();
+        if (has_non_null_key(options, "modular_expansion"))
+            modular_expansion = options["modular_expansion"].as<bool>();
     }
+    // a scan always reads IBP relations once, with symbolic kinematics
+    if (has_non_null_key(config_file, "kinematics_scan"))
+        symbolic_kinematics = true;
+    cache_dir = std::filesystem::path("tmp").append(integral_family);
+    open_caches();
     
     read_internals();
     read_externals();
@@ -59,6 +92,7 @@ config_parser::config_parser(const char* _config_file_name) {
     read_propagators();
     read_symbols();
     read_kinematics_numerics();
+    read_kinematics_scan();
     read_masters();
     compute_symanzik();
     read_master_values();
@@ -113,6 +147,13 @@ void config_parser::read_propagators() {
             .subs(substitution_rules, GiNaC::subs_options::algebraic)
         );
     }
+    if ((int)propagators.nops() > integral_index::max_size) {
+        std::cerr << "Integral families have at most " << integral_index::max_size
+                  << " propagators and ISPs, but " << integral_family << " has "
+                  << propagators.nops() << "!" << std::endl;
+        std::cerr << "Exiting..." << std::endl;
+        exit(1);
+    }
 }
 
 void config_parser::read_symbols() {
@@ -126,6 +167,8 @@ void config_parser::read_symbols() {
         if (symbol_file.eof())
             break;
         get(symbol_table, symbol);
+        if (symbol != "d")
+            kinematic_variables.append(symbol_table[symbol]);
     }
     symbol_file.close();
 }
@@ -145,6 +188,77 @@ void config_parser::read_kinematics_numerics() {
     }
 }
 
+void config_parser::read_kinematics_scan() {
+    if (!has_non_null_key(config_file, "kinematics_scan"))
+        return;
+    // a point of the scan overrides the values in kinematics_numerics
+    auto add_point = [this](const GiNaC::lst& overrides) {
+        GiNaC::lst point = overrides;
+        for (auto rule: kinematics_numerics) {
+            bool overridden = false;
+            for (auto override_rule: overrides)
+                overridden = overridden || override_rule.lhs().is_equal(rule.lhs());
+            if (!overridden)
+                point.append(rule);
+        }
+        kinematics_scan.push_back(point);
+    };
+    GiNaC::parser value_parser; // a parser for numeric values
+    auto scan = config_file["kinematics_scan"];
+    if (scan.IsSequence() && scan.size() > 0 && scan[0].IsScalar()) {
+        // a range [variable, begin, end, number of points]
+        auto range = scan.as<std::vector<std::string>>();
+        auto variable = get(symbol_table, range[0]);
+        auto begin = GiNaC::ex_to<GiNaC::numeric>(value_parser(range[1]));
+        auto end = GiNaC::ex_to<GiNaC::numeric>(value_parser(range[2]));
+        int num_points = std::stoi(range[3]);
+        for (int k = 0; k < num_points; k++) {
+            auto value = (num_points == 1) ? begin : begin + (end - begin) * k / (num_points - 1);
+            add_point(GiNaC::lst{variable == value});
+        }
+        return;
+    }
+    for (auto& point: scan.as<std::vector<YAML::Node>>()) {
+        GiNaC::lst overrides;
+        for (auto& v: point.as<std::vector<YAML::Node>>()) {
+            auto key_value = v.as<std::vector<std::string>>();
+            overrides.append(
+                get(symbol_table, key_value[0])
+                    == GiNaC::ex_to<GiNaC::numeric>(value_parser(key_value[1]))
+            );
+        }
+        add_point(overrides);
+    }
+}
+
+void config_parser::set_kinematics(const GiNaC::lst& numerics) {
+    kinematics_numerics = numerics;
+    substitute_kinematics();
+}
+
+void config_parser::substitute_kinematics() {
+    if (!symbolic_kinematics)
+        return;
+    START_TIME(substitute_kinematics);
+    std::vector<GiNaC::numeric> values;
+    for (auto variable: kinematic_variables) {
+        auto value = variable.subs(kinematics_numerics, GiNaC::subs_options::algebraic);
+        if (!GiNaC::is_exactly_a<GiNaC::numeric>(value))
+            throw std::runtime_error("config_parser::substitute_kinematics(): no numeric value for " 
+                                     + GiNaC::ex_to<GiNaC::symbol>(variable).get_name());
+        values.push_back(GiNaC::ex_to<GiNaC::numeric>(value));
+    }
+    ibp_table.clear();
+    for (auto& key_value: symbolic_relations) {
+        GiNaC::ex relation = 0;
+        for (auto& term: key_value.second)
+            relation += term.factor.subs(kinematics_numerics, GiNaC::subs_options::algebraic) * term.coefficient(values);
+        ibp_table[key_value.first] = relation;
+    }
+    END_TIME(substitute_kinematics);
+    PRINT_TIME(substitute_kinematics);
+}
+
 void config_parser::read_masters() {
     std::ifstream masters_file;
     std::filesystem::path masters_path = std::filesystem::path(kira_dir)
@@ -158,7 +272,7 @@ void config_parser::read_masters() {
         if (masters_file.eof())
             break;
         if (master.find(integral_family) != std::string::npos) {
-            std::string id = int_to_id(master);
+            integral_index id = int_to_id(master);
             master_table.push_back(id);
             get(integral_table, id, "I[", "]");
         }
@@ -209,19 +323,16 @@ void config_parser::compute_symanzik() {
 }
 
 void config_parser::read_master_values() {
-    std::set<std::string> known_masters;
+    std::unordered_set<integral_index, integral_index_hash> known_masters;
     GiNaC::parser parser(symbol_table);
     auto _values = config_file["master_values"].as<std::vector<YAML::Node>>();
     for (auto& _value: _values) {
         auto key_value = _value.as<std::vector<YAML::Node>>();
         auto keys = key_value[0].as<std::vector<YAML::Node>>();
-        int num_keys = keys.size();
-        std::string repr;
-        for (int i = 0; i < num_keys; i++) {
-            repr += keys[i].as<std::string>();
-            if (i != num_keys - 1)
-                repr += ",";
-        }
+        std::vector<int> indices;
+        for (auto& key: keys)
+            indices.push_back(key.as<int>());
+        integral_index repr(indices);
         known_masters.insert(repr);
         master_values.append(integral_table[repr] == parser(key_value[1].as<std::string>()));
     }
@@ -237,40 +348,124 @@ bool config_parser::check_euclidean(unsigned long seed, int trials) {
     START_TIME(check);
     auto numeric_F = symanzik_F.subs(kinematics_numerics, GiNaC::subs_options::algebraic);
     int n = effective_feynman_params.size();
-    random_feynman_params rng(n, seed);
-    std::vector<double> random_instance(n);
+    GiNaC::lst params;
+    for (int j = 0; j < n; j++)
+        params.append(feynman_params[effective_feynman_params[j]]);
+    compiled_polynomial compiled_U, compiled_F;
+    try {
+        compiled_U = compiled_polynomial(symanzik_U, params);
+        compiled_F = compiled_polynomial(numeric_F, params);
+    } catch (...) {
+        std::cerr << "Incomplete numerics for kinematics!" << std::endl;
+        return false;
+    }
+
+    // Trials are split into chunks, each drawn from a stream seeded by
+    // `seed` and the chunk index, and spread across up to
+    // `max_subprocesses` threads. Chunks are reduced in order, so results
+    // only depend on `seed`, not on the number of threads.
+    const int chunk_size = 1 << 16;
+    const int batch_size = 4096;
+    struct chunk_result {
+        double min_value, max_value, min_F;
+        std::vector<double> min_point, max_point, min_F_point;
+    };
+    int num_chunks = (trials + chunk_size - 1) / chunk_size;
+    int num_threads = std::max(1, std::min(max_subprocesses, num_chunks));
+    std::vector<chunk_result> results(num_chunks);
+    std::atomic<int> next_chunk(0);
+    std::atomic<long long> done(0);
+    std::atomic<bool> fail(false);
+    auto work = [&](random_feynman_params& rng) {
+        std::vector<double> random_instance(n);
+        std::vector<double> points(batch_size * n);
+        std::vector<double> evaluated_U(batch_size), evaluated_F(batch_size);
+        int c;
+        while (!fail && (c = next_chunk++) < num_chunks) {
+            std::uint64_t stream[2] = {seed, (std::uint64_t)c};
+            rng.seed(hash_bytes((const char*)stream, sizeof(stream)));
+            auto& result = results[c];
+            result.min_value = max_log_threshold;
+            result.max_value = min_log_threshold;
+            result.min_F = std::numeric_limits<double>::infinity();
+            int end = (int)std::min<long long>(trials, (long long)(c + 1) * chunk_size);
+            for (int i = c * chunk_size; i < end && !fail; i += batch_size) {
+                int count = std::min(batch_size, end - i);
+                for (int p = 0; p < count; p++) {
+                    rng(random_instance);
+                    std::copy(random_instance.begin(), random_instance.end(), points.begin() + p * n);
+                }
+                compiled_U.evaluate(points.data(), count, evaluated_U.data());
+                compiled_F.evaluate(points.data(), count, evaluated_F.data());
+                for (int p = 0; p < count; p++) {
+                    if (evaluated_F[p] <= 0) {
+                        fail = true;
+                        break;
+                    }
+                    if (evaluated_F[p] < result.min_F) {
+                        result.min_F = evaluated_F[p];
+                        result.min_F_point.assign(points.begin() + p * n, points.begin() + (p + 1) * n);
+                    }
+                    double value = std::pow(evaluated_U[p], num_internals + 1) / std::pow(evaluated_F[p], num_internals);
+                    if (value > result.max_value) {
+                        result.max_value = value;
+                        result.max_point.assign(points.begin() + p * n, points.begin() + (p + 1) * n);
+                    }
+                    if (value < result.min_value) {
+                        result.min_value = value;
+                        result.min_point.assign(points.begin() + p * n, points.begin() + (p + 1) * n);
+                    }
+                }
+                done += count;
+            }
+        }
+    };
+
+    // GSL generators are set up here, as gsl_rng_env_setup() is not
+    // thread-safe
+    std::vector<std::unique_ptr<random_feynman_params>> rngs;
+    for (int k = 0; k < num_threads; k++)
+        rngs.push_back(std::make_unique<random_feynman_params>(n, seed));
+    std::vector<std::thread> threads;
+    for (int k = 1; k < num_threads; k++)
+        threads.emplace_back(work, std::ref(*rngs[k]));
+    // progress is reported a few times per second
+    std::thread reporter([&]() {
+        while (done < trials && !fail) {
+            std::cerr << done << " / " << trials << " trials..." << "\r";
+            std::this_thread::sleep_for(std::chrono::milliseconds(250));
+        }
+    });
+    work(*rngs[0]);
+    for (auto& thread: threads)
+        thread.join();
+    reporter.join();
+    if (fail) {
+        std::cerr << std::endl << "Euclidean check failed!" << std::endl;
+        return false;
+    }
+    std::cerr << trials << " / " << trials << " trials..." << "\r";
+
     min_log_value = max_log_threshold;
     max_log_value = min_log_threshold;
-    for (int i = 0; i < trials; i++) {
-        rng(random_instance);
-        GiNaC::lst rules;
-        for (int j = 0; j < n; j++)
-            rules.append(feynman_params[effective_feynman_params[j]] == random_instance[j]);
-        double evaluated_F = 0;
-        try {
-            evaluated_F = to_double(numeric_F.subs(rules, GiNaC::subs_options::algebraic));
-        } catch (...) {
-            std::cerr << "Incomplete numerics for kinematics!" << std::endl;
-            return false;
-        }
-        if (evaluated_F <= 0) {
-            std::cerr << std::endl << "Euclidean check failed!" << std::endl;
-            return false;
+    double min_F = std::numeric_limits<double>::infinity();
+    std::vector<double> min_F_point;
+    for (auto& result: results) {
+        if (result.min_F < min_F) {
+            min_F = result.min_F;
+            min_F_point = result.min_F_point;
         }
-        double evaluated_U = to_double(symanzik_U.subs(rules, GiNaC::subs_options::algebraic));
-        double value = std::pow(evaluated_U, num_internals + 1) / std::pow(evaluated_F, num_internals);
-        if (value > max_log_value) {
-            max_log_value = value;
-            max_log_point = random_instance;
+        if (result.max_value > max_log_value) {
+            max_log_value = result.max_value;
+            max_log_point = result.max_point;
         }
-        if (value < min_log_value) {
-            min_log_value = value;
-            min_log_point = random_instance;
+        if (result.min_value < min_log_value) {
+            min_log_value = result.min_value;
+            min_log_point = result.min_point;
         }
-        std::cerr << i + 1 << " / " << trials << " trials..." << "\r";
     }
     END_TIME(check);
-    std::cerr << std::endl << "Euclidean check succeeded!" << std::endl;
+    std::cerr << std::endl;
     PRINT_TIME(check);
     std::cout << "Detected max(U^{L+1}/F^L) = " << max_log_value << " at ";
     GiNaC::lst max_rule;
@@ -284,6 +479,10 @@ bool config_parser::check_euclidean(unsigned long seed, int trials) {
         min_rule.append(feynman_params[effective_feynman_params[i]] == min_log_point[i]);
     }
     std::cout << min_rule << std::endl;
+    // the minimization may still find F < 0
+    if (will_minimize_euclidean && !minimize_euclidean(numeric_F, params, min_F_point))
+        return false;
+    std::cerr << "Euclidean check succeeded!" << std::endl;
     return true;
 }
 #endif // NO_GSL
@@ -5,10 +5,10 @@
 GiNaC::matrix config_parser::get_differential_equations(const GiNaC::symbol& symbol) {
     // map derivatives of master integrals at dimension d to linear
     // combinations of integrals at dimension d+2
-    std::map<std::string, GiNaC::symtab> collection;
-    std::map<std::string, int> master_to_id;
+    integral_map<integral_symtab> collection;
+    integral_map<int> master_to_id;
     int id = 0;
-    GiNaC::symtab expansion;
+    integral_symtab expansion;
     auto neg_deriv_F = -symanzik_F.subs(kinematics_numerics, GiNaC::subs_options::algebraic)
                                   .diff(symbol).expand();
     for (auto& master: master_table) {
@@ -30,7 +30,7 @@ GiNaC::matrix config_parser::get_differential_equations(const GiNaC::symbol& sym
         int r = master_to_id[row.first];
         for (auto& col: row.second) {
             if (storage.find(col.first) == storage.end()) {
-                std::cerr << "The integral I[" << col.first << "] is absent in IBP!" << std::endl;
+                std::cerr << "The integral I[" << col.first.to_string() << "] is absent in IBP!" << std::endl;
                 return GiNaC::matrix(0, 0);
             }
             auto& col_map = storage[col.first];
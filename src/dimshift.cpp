@@ -5,10 +5,10 @@
 GiNaC::matrix config_parser::get_shift_to_upper_dim() {
     // map master integrals at dimension d-2 to linear combinations of
     // integrals at dimension d
-    std::map<std::string, GiNaC::symtab> collection;
-    std::map<std::string, int> master_to_id;
+    integral_map<integral_symtab> collection;
+    integral_map<int> master_to_id;
     int id = 0;
-    GiNaC::symtab expansion;
+    integral_symtab expansion;
     for (auto& master: master_table) {
         master_to_id[master] = id++;
         collection[master] = poly_to_terms(master, symanzik_U, &expansion);
@@ -28,7 +28,7 @@ GiNaC::matrix config_parser::get_shift_to_upper_dim() {
         int r = master_to_id[row.first];
         for (auto& col: row.second) {
             if (storage.find(col.first) == storage.end()) {
-                std::cerr << "The integral I[" << col.first << "] is absent in IBP!" << std::endl;
+                std::cerr << "The integral I[" << col.first.to_string() << "] is absent in IBP!" << std::endl;
                 return GiNaC::matrix(0, 0);
             }
             auto& col_map = storage[col.first];
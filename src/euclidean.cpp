@@ -0,0 +1,157 @@
+#ifndef NO_GSL
+#include "config.hpp"
+#include "utils.hpp"
+#include "evaluate.hpp"
+#include "simplex.hpp"
+#include <algorithm>
+#include <cmath>
+
+bool config_parser::minimize_euclidean(const GiNaC::ex& numeric_F, const GiNaC::lst& params,
+                                       const std::vector<double>& min_F_point) {
+    std::cerr << "Euclidean minimization starts..." << std::endl;
+    START_TIME(minimize);
+    int n = params.nops();
+    compiled_polynomial compiled_U(symanzik_U, params), compiled_F(numeric_F, params);
+    std::vector<compiled_polynomial> U_gradient, F_gradient;
+    for (int i = 0; i < n; i++) {
+        GiNaC::symbol x = GiNaC::ex_to<GiNaC::symbol>(params[i]);
+        U_gradient.push_back(compiled_polynomial(symanzik_U.diff(x), params));
+        F_gradient.push_back(compiled_polynomial(numeric_F.diff(x), params));
+    }
+    auto print_point = [&params](const std::vector<double>& point) {
+        GiNaC::lst rule;
+        for (std::size_t i = 0; i < point.size(); i++)
+            rule.append(params[i] == point[i]);
+        std::cout << rule << std::endl;
+    };
+
+    // F at the centroids of all faces of the simplex, or of its vertices
+    // and edges only if there are too many faces
+    std::vector<std::vector<double>> centroids;
+    if (n <= 16) {
+        for (std::size_t mask = 1; mask < ((std::size_t)1 << n); mask++) {
+            std::vector<double> centroid(n);
+            int size = __builtin_popcountll(mask);
+            for (int i = 0; i < n; i++)
+                centroid[i] = (mask >> i & 1) ? 1.0 / size : 0.0;
+            centroids.push_back(centroid);
+        }
+    } else {
+        for (int i = 0; i < n; i++) {
+            for (int j = i; j < n; j++) {
+                std::vector<double> centroid(n);
+                centroid[i] += (i == j) ? 1.0 : 0.5;
+                centroid[j] += (i == j) ? 0.0 : 0.5;
+                centroids.push_back(centroid);
+            }
+        }
+    }
+    int num_centroids = centroids.size();
+    std::vector<double> points, centroid_F(num_centroids);
+    for (auto& centroid: centroids)
+        points.insert(points.end(), centroid.begin(), centroid.end());
+    compiled_F.evaluate(points.data(), num_centroids, centroid_F.data());
+
+    // F may vanish on the boundary, so only values below a tolerance
+    // relative to the scale of F count as negative
+    double scale = 0;
+    for (auto value: centroid_F)
+        scale = std::max(scale, std::abs(value));
+    double tolerance = -1e-10 * scale;
+    int worst = std::min_element(centroid_F.begin(), centroid_F.end()) - centroid_F.begin();
+    if (centroid_F[worst] < tolerance) {
+        std::cerr << "Euclidean check failed!" << std::endl;
+        std::cout << "Found F = " << centroid_F[worst] << " at ";
+        print_point(centroids[worst]);
+        return false;
+    }
+
+    // minimize F from the worst random sample, the extrema of
+    // U^{L+1}/F^L, the centroid, and the faces where F is smallest
+    std::vector<std::vector<double>> seeds = {
+        min_F_point, min_log_point, max_log_point, std::vector<double>(n, 1.0 / n)
+    };
+    std::vector<int> order(num_centroids);
+    for (int k = 0; k < num_centroids; k++)
+        order[k] = k;
+    int num_faces = std::min(num_centroids, 8);
+    std::partial_sort(order.begin(), order.begin() + num_faces, order.end(),
+                      [&centroid_F](int a, int b) { return centroid_F[a] < centroid_F[b]; });
+    for (int k = 0; k < num_faces; k++)
+        seeds.push_back(centroids[order[k]]);
+
+    simplex_objective F = [&](const std::vector<double>& x, std::vector<double>& gradient) {
+        for (int i = 0; i < n; i++)
+            gradient[i] = F_gradient[i](x.data());
+        return compiled_F(x.data());
+    };
+    double min_F = std::numeric_limits<double>::infinity();
+    std::vector<double> min_F_location;
+    for (auto& seed: seeds) {
+        if ((int)seed.size() != n)
+            continue;
+        auto x = seed;
+        double value = minimize_on_simplex(F, x, 1000, tolerance);
+        if (value < min_F) {
+            min_F = value;
+            min_F_location = x;
+        }
+    }
+    if (min_F < tolerance) {
+        std::cerr << "Euclidean check failed!" << std::endl;
+        std::cout << "Found F = " << min_F << " at ";
+        print_point(min_F_location);
+        return false;
+    }
+
+    // refine the extrema of U^{L+1}/F^L through its logarithm
+    bool found_negative = false;
+    std::vector<double> negative_point;
+    auto log_ratio = [&](double sign) -> simplex_objective {
+        return [&, sign](const std::vector<double>& x, std::vector<double>& gradient) {
+            double u = compiled_U(x.data()), f = compiled_F(x.data());
+            if (f < tolerance && !found_negative) {
+                found_negative = true;
+                negative_point = x;
+            }
+            if (u <= 0 || f <= 0)
+                return std::numeric_limits<double>::quiet_NaN();
+            for (int i = 0; i < n; i++)
+                gradient[i] = sign * ((num_internals + 1) * U_gradient[i](x.data()) / u
+                                      - num_internals * F_gradient[i](x.data()) / f);
+            return sign * ((num_internals + 1) * std::log(u) - num_internals * std::log(f));
+        };
+    };
+    auto min_point = min_log_point, max_point = max_log_point;
+    double refined_min = min_log_value, refined_max = max_log_value;
+    if ((int)min_point.size() == n)
+        refined_min = std::exp(minimize_on_simplex(log_ratio(1), min_point));
+    if ((int)max_point.size() == n)
+        refined_max = std::exp(-minimize_on_simplex(log_ratio(-1), max_point));
+    if (found_negative) {
+        std::cerr << "Euclidean check failed!" << std::endl;
+        std::cout << "Found F < 0 at ";
+        print_point(negative_point);
+        return false;
+    }
+    if (refined_min < min_log_value) {
+        min_log_value = refined_min;
+        min_log_point = min_point;
+    }
+    if (refined_max > max_log_value) {
+        max_log_value = refined_max;
+        max_log_point = max_point;
+    }
+    END_TIME(minimize);
+
+    std::cerr << "Euclidean minimization succeeded!" << std::endl;
+    PRINT_TIME(minimize);
+    std::cout << "Minimized F = " << min_F << " at ";
+    print_point(min_F_location);
+    std::cout << "Refined max(U^{L+1}/F^L) = " << max_log_value << " at ";
+    print_point(max_log_point);
+    std::cout << "Refined min(U^{L+1}/F^L) = " << min_log_value << " at ";
+    print_point(min_log_point);
+    return true;
+}
+#endif // NO_GSL
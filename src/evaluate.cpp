@@ -0,0 +1,242 @@
+#include "evaluate.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+horner_program::horner_program(const GiNaC::ex& polynomial, const GiNaC::lst& vars)
+    : num_vars(vars.nops()), max_degree(0), max_depth(0) {
+    std::vector<term> terms;
+    GiNaC::ex expanded_polynomial = polynomial.expand();
+    auto termp = polynomial_iterator(expanded_polynomial), end = termp.end();
+    for (; termp != end; ++termp) {
+        GiNaC::ex monomial = *termp;
+        term t;
+        for (int v = 0; v < num_vars; v++) {
+            int degree = monomial.degree(vars[v]);
+            t.exponents.push_back(degree);
+            max_degree = std::max(max_degree, degree);
+            monomial = monomial.lcoeff(vars[v]);
+        }
+        if (!GiNaC::is_exactly_a<GiNaC::numeric>(monomial))
+            monomial = monomial.evalf();
+        if (!GiNaC::is_exactly_a<GiNaC::numeric>(monomial))
+            throw std::runtime_error("horner_program: non-numeric coefficient");
+        t.coefficient = GiNaC::ex_to<GiNaC::numeric>(monomial);
+        if (!t.coefficient.is_zero())
+            terms.push_back(t);
+    }
+    // highest powers first, so that terms sharing the powers of the
+    // leading variables are adjacent
+    std::sort(terms.begin(), terms.end(), [](const term& a, const term& b) {
+        return a.exponents > b.exponents;
+    });
+    if (!terms.empty())
+        emit(terms, 0, terms.size(), 0, 1);
+    for (auto& c: constants)
+        double_constants.push_back(c.to_double());
+    stack_buffer.resize(max_depth);
+}
+
+void horner_program::emit(const std::vector<term>& terms, std::size_t begin, std::size_t end, int var, int depth) {
+    max_depth = std::max(max_depth, depth);
+    if (var == num_vars) {
+        // all exponents agree, so the terms add up to one coefficient
+        for (std::size_t t = begin; t < end; t++) {
+            constants.push_back(terms[t].coefficient);
+            program.push_back(instruction{push_constant, 0, (int)constants.size() - 1});
+            if (t != begin) {
+                program.push_back(instruction{add_top, 0, 0});
+                max_depth = std::max(max_depth, depth + 1);
+            }
+        }
+        return;
+    }
+    // the groups g_0, g_1, ... of terms with powers e_0 > e_1 > ... of
+    // `var` combine as ((g_0 x^(e_0 - e_1) + g_1) x^(e_1 - e_2) + ...) x^e_n
+    std::size_t group = begin;
+    int previous = -1;
+    while (group < end) {
+        int exponent = terms[group].exponents[var];
+        std::size_t next = group;
+        while (next < end && terms[next].exponents[var] == exponent)
+            next++;
+        if (previous >= 0)
+            program.push_back(instruction{multiply_power, var, previous - exponent});
+        emit(terms, group, next, var + 1, (previous >= 0) ? depth + 1 : depth);
+        if (previous >= 0)
+            program.push_back(instruction{add_top, 0, 0});
+        previous = exponent;
+        group = next;
+    }
+    if (previous > 0)
+        program.push_back(instruction{multiply_power, var, previous});
+}
+
+void horner_program::evaluate(const double* powers, std::size_t stride, std::size_t count, double* values) const {
+    if (program.empty()) {
+        for (std::size_t p = 0; p < count; p++)
+            values[p] = 0;
+        return;
+    }
+    // the stack holds `count` values per entry; top points to the last one
+    std::vector<double> stack(max_depth * count);
+    double* top = stack.data();
+    bool empty = true;
+    for (auto& i: program) {
+        switch (i.op) {
+        case push_constant: {
+            if (!empty)
+                top += count;
+            empty = false;
+            double c = double_constants[i.arg];
+            for (std::size_t p = 0; p < count; p++)
+                top[p] = c;
+            break;
+        }
+        case multiply_power: {
+            const double* row = powers + (i.var * stride + i.arg) * count;
+            for (std::size_t p = 0; p < count; p++)
+                top[p] *= row[p];
+            break;
+        }
+        case add_top: {
+            top -= count;
+            for (std::size_t p = 0; p < count; p++)
+                top[p] += top[p + count];
+            break;
+        }
+        }
+    }
+    for (std::size_t p = 0; p < count; p++)
+        values[p] = stack[p];
+}
+
+double horner_program::evaluate(const double* x) const {
+    if (program.empty())
+        return 0;
+    double* top = stack_buffer.data();
+    bool empty = true;
+    for (auto& i: program) {
+        switch (i.op) {
+        case push_constant:
+            if (!empty)
+                top++;
+            empty = false;
+            *top = double_constants[i.arg];
+            break;
+        case multiply_power: {
+            // exponents of single steps are small, so no table of powers
+            double base = x[i.var];
+            for (int e = i.arg; e > 0; e--)
+                *top *= base;
+            break;
+        }
+        case add_top:
+            top--;
+            top[0] += top[1];
+            break;
+        }
+    }
+    return stack_buffer[0];
+}
+
+GiNaC::numeric horner_program::evaluate(const std::vector<std::vector<GiNaC::numeric>>& powers) const {
+    if (program.empty())
+        return 0;
+    std::vector<GiNaC::numeric> stack;
+    stack.reserve(max_depth);
+    for (auto& i: program) {
+        switch (i.op) {
+        case push_constant:
+            stack.push_back(constants[i.arg]);
+            break;
+        case multiply_power:
+            stack.back() *= powers[i.var][i.arg];
+            break;
+        case add_top: {
+            GiNaC::numeric top = stack.back();
+            stack.pop_back();
+            stack.back() += top;
+            break;
+        }
+        }
+    }
+    return stack.back();
+}
+
+double compiled_polynomial::operator()(const double* x) const {
+    return program.evaluate(x);
+}
+
+void compiled_polynomial::evaluate(const double* points, std::size_t count, double* values) const {
+    // powers[(v * (degree + 1) + k) * count + p] = x_v^k at point p, so
+    // that the loops over points are contiguous
+    int num_vars = program.variables();
+    std::size_t stride = program.degree() + 1;
+    std::vector<double> powers(num_vars * stride * count);
+    for (int v = 0; v < num_vars; v++) {
+        double* row = powers.data() + v * stride * count;
+        for (std::size_t p = 0; p < count; p++)
+            row[p] = 1;
+        for (std::size_t k = 1; k < stride; k++) {
+            for (std::size_t p = 0; p < count; p++)
+                row[k * count + p] = row[(k - 1) * count + p] * points[p * num_vars + v];
+        }
+    }
+    program.evaluate(powers.data(), stride, count, values);
+}
+
+// split an expanded polynomial by powers of x, and compile every coefficient
+static std::vector<horner_program> compile_by_powers(const GiNaC::ex& expanded, const GiNaC::ex& x,
+                                                     const GiNaC::lst& params) {
+    std::vector<horner_program> programs;
+    int degree = expanded.degree(x);
+    for (int k = 0; k <= degree; k++)
+        programs.push_back(horner_program(expanded.coeff(x, k), params));
+    return programs;
+}
+
+compiled_rational::compiled_rational(const GiNaC::ex& _numerator, const GiNaC::ex& _denominator,
+                                     const GiNaC::symbol& _x, const GiNaC::lst& params)
+    : x(_x), num_params(params.nops()), max_degree(0) {
+    numerator = compile_by_powers(_numerator, x, params);
+    denominator = compile_by_powers(_denominator, x, params);
+    for (auto programs: {&numerator, &denominator}) {
+        for (auto& program: *programs)
+            max_degree = std::max(max_degree, program.degree());
+    }
+}
+
+compiled_rational compiled_rational::one() {
+    compiled_rational result;
+    result.numerator.push_back(horner_program(1, GiNaC::lst()));
+    result.denominator.push_back(horner_program(1, GiNaC::lst()));
+    return result;
+}
+
+GiNaC::ex compiled_rational::operator()(const std::vector<GiNaC::numeric>& values) const {
+    // powers[v][k] = values[v]^k, up to the highest power in use
+    std::vector<std::vector<GiNaC::numeric>> powers(num_params, std::vector<GiNaC::numeric>(1, 1));
+    for (int v = 0; v < num_params; v++) {
+        for (int k = 1; k <= max_degree; k++)
+            powers[v].push_back(powers[v].back() * values[v]);
+    }
+    auto evaluate = [this, &powers](const std::vector<horner_program>& programs) {
+        GiNaC::ex result = 0;
+        int num_powers = programs.size();
+        for (int k = 0; k < num_powers; k++) {
+            GiNaC::numeric c = programs[k].evaluate(powers);
+            if (c.is_zero())
+                continue;
+            if (k == 0)
+                result += c;
+            else
+                result += c * GiNaC::pow(x, k);
+        }
+        return result;
+    };
+    GiNaC::ex denominator_value = evaluate(denominator);
+    if (denominator_value.is_zero())
+        throw std::runtime_error("compiled_rational: vanishing denominator");
+    return evaluate(numerator) / denominator_value;
+}
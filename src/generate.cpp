@@ -1,23 +1,18 @@
 #include "generate.hpp"
 #include "utils.hpp"
 
-static GiNaC::matrix get_quadratic_form(const GiNaC::ex& prefactor,
-                                        const GiNaC::lst& terms) {
-    int n = terms.nops();
-
-    GiNaC::matrix out(n, n);
-    int i = 0;
-    for (auto p1 = terms.begin(); p1 != terms.end(); ++p1, i++) {
-        int j = 0;
-        for (auto p2 = terms.begin(); p2 != terms.end(); ++p2, j++) {
-            out(i, j) = prefactor * (*p1) * (*p2);
-        }
+static quadratic_form get_quadratic_form(const GiNaC::ex& prefactor,
+                                         const GiNaC::lst& terms) {
+    quadratic_form out;
+    out.prefactor = prefactor;
+    for (auto& term: terms) {
+        out.terms.push_back(term);
     }
 
     return out;
 }
 
-GiNaC::matrix polynomial_generator::generate(
+quadratic_form polynomial_generator::generate(
     const std::string& prefactor, const std::vector<std::string>& terms) {
     
     GiNaC::ex prefactor_ex = (*parser)(prefactor);
@@ -29,7 +24,7 @@ GiNaC::matrix polynomial_generator::generate(
     return get_quadratic_form(prefactor_ex, list_terms);
 }
 
-GiNaC::matrix polynomial_generator::generate(
+quadratic_form polynomial_generator::generate(
     const std::string& prefactor, int min_x_degree, int max_x_degree, int max_log_degree) {
     
     GiNaC::ex prefactor_ex = (*parser)(prefactor);
@@ -58,9 +53,9 @@ GiNaC::matrix polynomial_generator::generate(
     return get_quadratic_form(prefactor_ex, terms);
 }
 
-std::vector<GiNaC::matrix> polynomial_generator::generate_from_config() {
+std::vector<quadratic_form> polynomial_generator::generate_from_config() {
     auto ansatze = (*configp)["ansatze"].as<std::vector<YAML::Node>>();
-    std::vector<GiNaC::matrix> results;
+    std::vector<quadratic_form> results;
     for (auto& ansatz: ansatze) {
         auto parts = ansatz.as<std::vector<YAML::Node>>();
         if (parts.size() == 4) {
@@ -1,40 +1,39 @@
 #include <fstream>
 #include "utils.hpp"
 #include "config.hpp"
+#include "kira.hpp"
 
 void config_parser::read_ibps() {
-    count_ibps();
-    std::ifstream ibp_result_file(ibp_result_filename);
-    std::string ibp, current_key;
-    std::size_t _asterisk, counter = 0;
+    kira_reader reader(ibp_result_filename, integral_family);
+    ibp_count = reader.num_heads();
+    integral_index current_key;
+    std::size_t num_records = reader.num_records(), counter = 0;
     bool fail = false;
+    auto callback = [this](const integral_index& k, const integral_index& i) { read_mainprocess_work(k, i); };
     START_TIME(read_ibp);
-    while (true) {
-        ibp_result_file >> ibp;
-        if (ibp_result_file.eof())
-            break;
-        if (ibp.find(integral_family) != std::string::npos) {
-            if ((_asterisk = ibp.find('*')) == std::string::npos) { // an IBP head
-                fail = false;
-                counter++;
-                current_key = int_to_id(ibp);
-                fail = !get_prefactor(current_key, t, num_internals, symbol_table["d"],
-                                      sector_designate, top_level_sector).first;
-                if (fail)
-                    continue;
-                get(integral_table, current_key, "I[", "]");
-                ibp_table[current_key] = 0;
-                std::cerr << "Processing the " << counter << "-th / " << ibp_count << " IBP relation" << "\r";
-            } else if (!fail) { // an IBP body
-                auto current_integral = int_to_id(ibp);
-                if (read_cache_exists(current_key, current_integral)) {
-                    read_mainprocess_work(current_key, current_integral);
-                } else {
-                    if (working_subprocesses == max_subprocesses) {
-                        read_subprocess_yield(false, [this](auto k, auto i) { read_mainprocess_work(k, i); });
-                    }
-                    read_subprocess_work(current_key, current_integral, ibp.substr(_asterisk + 1));
-                }
+    read_subprocess_start();
+    for (std::size_t r = 0; r < num_records; r++) {
+        auto record = reader[r];
+        if (record.head) { // an IBP head
+            read_subprocess_next_relation(callback);
+            fail = false;
+            counter++;
+            current_key = int_to_id(record.integral);
+            fail = !get_prefactor(current_key, t, num_internals, symbol_table["d"],
+                                  sector_designate, top_level_sector).first;
+            if (fail)
+                continue;
+            get(integral_table, current_key, "I[", "]");
+            ibp_table[current_key] = 0;
+            if (symbolic_kinematics)
+                symbolic_relations[current_key].clear();
+            std::cerr << "Processing the " << counter << "-th / " << ibp_count << " IBP relation" << "\r";
+        } else if (!fail) { // an IBP body
+            auto current_integral = int_to_id(record.integral);
+            if (read_cache_exists(current_key, current_integral)) {
+                read_mainprocess_work(current_key, current_integral);
+            } else {
+                read_subprocess_work(current_key, current_integral, std::string(record.coefficient));
             }
         }
     }
@@ -42,58 +41,72 @@ void config_parser::read_ibps() {
     for (auto& master: master_table) {
         auto rhs_integral = get(integral_table, master, "I[", "]")
             .subs(master_values, GiNaC::subs_options::algebraic)
-            .subs(kinematics_numerics, GiNaC::subs_options::algebraic);
+            .subs(read_stage_numerics(), GiNaC::subs_options::algebraic);
         auto output = get_prefactor(master, t, num_internals, symbol_table["d"],
                                     sector_designate, top_level_sector);
         if (!output.first)
             continue;
         ibp_table[master] = rhs_integral * output.second;
+        if (symbolic_kinematics)
+            symbolic_relations[master] = {symbolic_term{rhs_integral * output.second, compiled_rational::one()}};
     }
-    while (working_subprocesses != 0)
-        read_subprocess_yield(true, [this](auto k, auto i) { read_mainprocess_work(k, i); });
+    read_subprocess_submit(callback);
+    while (workers.busy() != 0)
+        read_subprocess_yield(true, callback);
+    workers.stop();
+    substitute_kinematics();
     END_TIME(read_ibp);
 
     std::cerr << std::endl << "Done!" << std::endl;
     PRINT_TIME(read_ibp);
-    ibp_result_file.close();
 }
 
 void config_parser::expand_ibps(int order) {
     START_TIME(expand_ibp);
+    open_expand_cache(order);
     // generate integrals at different order
-    numeric_integral_table = std::vector<GiNaC::symtab>(order + 1);
+    numeric_integral_table = std::vector<integral_symtab>(order + 1);
     for (int i = 0; i <= order; i++) {
         for (auto& key_value: integral_table) {
             get(numeric_integral_table[i], key_value.first, "I[", "]_" + std::to_string(i));
         }
     }
-    // generate expansion rules
-    GiNaC::symbol eps("eps");
-    GiNaC::lst rules;
-    rules.append(symbol_table["d"] == d0 - 2 * eps);
+    // unknowns are ordered as in master_solver
+    unknown_list = GiNaC::lst();
+    unknown_indices.clear();
+    for (int i = 0; i <= order; i++) {
+        for (auto& name: effective_master_table) {
+            unknown_indices[numeric_integral_table[i][name]] = unknown_list.nops();
+            unknown_list.append(numeric_integral_table[i][name]);
+        }
+    }
+    // every integral expands as I = I_0 + I_1 eps + ... + I_order eps^order
+    integral_expansions.clear();
     for (auto& key_value: integral_table) {
-        GiNaC::ex rhs = 0;
+        GiNaC::lst coefficients;
         for (int i = 0; i <= order; i++) {
-            rhs += (numeric_integral_table[i][key_value.first] * GiNaC::pow(eps, i));
+            coefficients.append(numeric_integral_table[i][key_value.first]);
         }
-        rules.append(key_value.second == rhs);
+        integral_expansions[key_value.second] = coefficients;
     }
     // generate IBP equations at different order
-    numeric_ibp_table = std::vector<GiNaC::symtab>(order + 1);
+    numeric_ibp_table = std::vector<integral_map<linear_form>>(order + 1);
     int num_effective_ibps = ibp_table.size(), counter = 0;
-    for (auto& key_value: ibp_table) {
+    expand_subprocess_start(integral_expansions, order);
+    for (auto& key: sorted_keys(ibp_table)) {
         std::cerr << "Processing the " << ++counter << "-th / " << num_effective_ibps << " IBP relation" << "\r";
-        if (expand_cache_exists(key_value.first)) {
-            expand_mainprocess_work(key_value.first);
+        if (expand_cache_exists(key)) {
+            expand_mainprocess_work(key);
         } else {
-            if (working_subprocesses == max_subprocesses) {
+            if (workers.full()) {
                 expand_subprocess_yield(false);
             }
-            expand_subprocess_work(key_value.first, key_value.second, rules, order, eps);
+            expand_subprocess_work(key);
         }
     }
-    while (working_subprocesses != 0)
+    while (workers.busy() != 0)
         expand_subprocess_yield(true);
+    workers.stop();
     END_TIME(expand_ibp);
     
     std::cerr << std::endl << "Done!" << std::endl;
@@ -104,80 +117,59 @@ void config_parser::expand_ibps() {
     expand_ibps(eps_order);
 }
 
-void config_parser::count_ibps() {
-    std::ifstream ibp_result_file(ibp_result_filename);
-    std::string ibp;
-    int counter = 0;
-    while (true) {
-        ibp_result_file >> ibp;
-        if (ibp_result_file.eof())
-            break;
-        if (ibp.find(integral_family) != std::string::npos
-         && ibp.find('*') == std::string::npos)
-            counter++;
-    }
-    ibp_result_file.close();
-    ibp_count = counter;
-}
-
 void config_parser::dump_raw_ibps(std::ostream& out) {
-    for (auto& ibp: ibp_table) {
-        out << integral_table[ibp.first] << " = " << ibp.second << std::endl;
+    for (auto& key: sorted_keys(ibp_table)) {
+        out << integral_table[key] << " = " << ibp_table[key] << std::endl;
     }
 }
 
 void config_parser::dump_expanded_ibps(std::ostream& out) {
     int order_ = numeric_integral_table.size();
     for (int i = 0; i < order_; i++) {
-        for (auto& ibp: numeric_ibp_table[i]) {
-            out << numeric_integral_table[i][ibp.first] << " = "
-                << ibp.second << std::endl;
+        for (auto& key: sorted_keys(numeric_ibp_table[i])) {
+            out << numeric_integral_table[i][key] << " = "
+                << numeric_ibp_table[i][key].to_ex(unknown_list) << std::endl;
         }
     }
 }
 
-std::map<std::string, GiNaC::symtab> config_parser::read_selected_ibps(const GiNaC::symtab& integrals) {
-    std::ifstream ibp_result_file(ibp_result_filename);
-    std::string ibp, current_key;
-    std::map<std::string, GiNaC::symtab> storage;
-    std::size_t _asterisk;
+integral_map<integral_symtab> config_parser::read_selected_ibps(const integral_symtab& integrals) {
+    kira_reader reader(ibp_result_filename, integral_family);
+    integral_index current_key;
+    integral_map<integral_symtab> storage;
+    std::size_t num_records = reader.num_records();
     bool exist = false;
-    while (true) {
-        ibp_result_file >> ibp;
-        if (ibp_result_file.eof())
-            break;
-        if (ibp.find(integral_family) != std::string::npos) {
-            if ((_asterisk = ibp.find('*')) == std::string::npos) { // an IBP head
-                current_key = int_to_id(ibp);
-                exist = (integrals.find(current_key) != integrals.end());
-                if (exist)
-                    storage[current_key] = GiNaC::symtab();
-            } else if (exist) { // an IBP body
-                auto current_integral = int_to_id(ibp);
-                if (read_cache_exists(current_key, current_integral)) {
-                    storage[current_key][current_integral] 
-                        = read_ibp_simple(current_key, current_integral);
-                } else {
-                    if (working_subprocesses == max_subprocesses) {
-                        read_subprocess_yield(false, [this, &storage](auto k, auto i) {
-                            storage[k][i] = read_ibp_simple(k, i);
-                        });
-                    }
-                    read_subprocess_work(current_key, current_integral, ibp.substr(_asterisk + 1));
-                }
+    auto callback = [this, &storage](const integral_index& k, const integral_index& i) {
+        storage[k][i] = read_ibp_simple(k, i);
+    };
+    read_subprocess_start();
+    for (std::size_t r = 0; r < num_records; r++) {
+        auto record = reader[r];
+        if (record.head) { // an IBP head
+            read_subprocess_next_relation(callback);
+            current_key = int_to_id(record.integral);
+            exist = (integrals.find(current_key) != integrals.end());
+            if (exist)
+                storage[current_key] = integral_symtab();
+        } else if (exist) { // an IBP body
+            auto current_integral = int_to_id(record.integral);
+            if (read_cache_exists(current_key, current_integral)) {
+                storage[current_key][current_integral] 
+                    = read_ibp_simple(current_key, current_integral);
+            } else {
+                read_subprocess_work(current_key, current_integral, std::string(record.coefficient));
             }
         }
     }
     // add IBP entries for master integrals themselves
     for (auto& master: master_table) {
-        storage[master] = GiNaC::symtab();
+        storage[master] = integral_symtab();
         storage[master][master] = 1;
     }
-    while (working_subprocesses != 0)
-        read_subprocess_yield(true, [this, &storage](auto k, auto i) {
-            storage[k][i] = read_ibp_simple(k, i);
-        });
-    ibp_result_file.close();
+    read_subprocess_submit(callback);
+    while (workers.busy() != 0)
+        read_subprocess_yield(true, callback);
+    workers.stop();
 
     return storage;
 }
@@ -0,0 +1,85 @@
+#include "index.hpp"
+#include <cstring>
+#include <stdexcept>
+
+integral_index::integral_index(const std::vector<int>& indices) : words{0, 0} {
+    int n = indices.size();
+    if (n > max_size)
+        throw std::out_of_range("integral_index: too many indices");
+    for (int i = 0; i < n; i++) {
+        if (indices[i] < INT8_MIN || indices[i] > INT8_MAX)
+            throw std::out_of_range("integral_index: index out of range");
+        set_slot(i, indices[i]);
+    }
+    set_slot(max_size, n);
+}
+
+integral_index integral_index::parse(std::string_view str) {
+    std::size_t start = str.find('[');
+    start = (start == std::string_view::npos) ? 0 : start + 1;
+    std::size_t end = str.find(']', start);
+    if (end == std::string_view::npos)
+        end = str.size();
+
+    auto is_digit = [](char c) {
+        return c >= '0' && c <= '9';
+    };
+    integral_index index;
+    int n = 0;
+    std::size_t pos = start;
+    while (true) {
+        // skip separators, including blanks and repeated commas
+        while (pos < end && str[pos] != '-' && str[pos] != '+' && !is_digit(str[pos]))
+            pos++;
+        if (pos == end)
+            break;
+        bool negative = false;
+        if (str[pos] == '-' || str[pos] == '+')
+            negative = (str[pos++] == '-');
+        if (pos == end || !is_digit(str[pos]))
+            throw std::invalid_argument("integral_index: sign without digits in " + std::string(str));
+        int value = 0;
+        while (pos < end && is_digit(str[pos]))
+            value = value * 10 + (str[pos++] - '0');
+        value = negative ? -value : value;
+        if (n == max_size || value < INT8_MIN || value > INT8_MAX)
+            throw std::out_of_range("integral_index: cannot pack " + std::string(str));
+        index.set_slot(n++, value);
+    }
+    index.set_slot(max_size, n);
+    return index;
+}
+
+std::vector<int> integral_index::to_vector() const {
+    int n = size();
+    std::vector<int> indices(n);
+    for (int i = 0; i < n; i++) {
+        indices[i] = (*this)[i];
+    }
+    return indices;
+}
+
+std::string integral_index::to_string() const {
+    std::string str;
+    int n = size();
+    for (int i = 0; i < n; i++) {
+        str += std::to_string((*this)[i]);
+        if (i != n - 1)
+            str += ",";
+    }
+    return str;
+}
+
+std::string integral_index::raw() const {
+    std::string bytes(sizeof(words), '\0');
+    std::memcpy(bytes.data(), words, sizeof(words));
+    return bytes;
+}
+
+integral_index integral_index::from_raw(std::string_view raw) {
+    integral_index index;
+    if (raw.size() != sizeof(index.words))
+        throw std::invalid_argument("integral_index::from_raw(): wrong size");
+    std::memcpy(index.words, raw.data(), sizeof(index.words));
+    return index;
+}
@@ -0,0 +1,70 @@
+#include "kira.hpp"
+#include <fstream>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+kira_reader::kira_reader(const std::string& filename, const std::string& integral_family)
+    : data(nullptr), size(0), mapped(false), heads(0) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("kira_reader(): cannot open " + filename);
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        size = st.st_size;
+        void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            madvise(p, size, MADV_SEQUENTIAL);
+            data = (const char*)p;
+            mapped = true;
+        }
+    }
+    close(fd);
+
+    if (!mapped) { // e.g. pipes or empty files
+        std::ifstream in(filename, std::ios::binary);
+        buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        data = buffer.data();
+        size = buffer.size();
+    }
+
+    tokenize(integral_family);
+}
+
+kira_reader::~kira_reader() {
+    if (mapped)
+        munmap((void*)data, size);
+}
+
+void kira_reader::tokenize(const std::string& integral_family) {
+    // same delimiters as `std::istream::operator>>` in the C locale
+    bool space[256] = {false};
+    space[(unsigned char)' '] = space[(unsigned char)'\t'] = space[(unsigned char)'\n']
+        = space[(unsigned char)'\v'] = space[(unsigned char)'\f'] = space[(unsigned char)'\r'] = true;
+
+    std::size_t pos = 0;
+    while (pos < size) {
+        while (pos < size && space[(unsigned char)data[pos]])
+            pos++;
+        std::size_t start = pos;
+        while (pos < size && !space[(unsigned char)data[pos]])
+            pos++;
+        if (pos == start)
+            break;
+
+        std::string_view token(data + start, pos - start);
+        if (token.find(integral_family) == std::string_view::npos)
+            continue;
+        if (token.size() > UINT32_MAX)
+            throw std::runtime_error("kira_reader(): token too long");
+        std::size_t asterisk = token.find('*');
+        if (asterisk == std::string_view::npos) {
+            records.push_back(packed_record{start, (std::uint32_t)token.size(), head_mark});
+            heads++;
+        } else {
+            records.push_back(packed_record{start, (std::uint32_t)token.size(), (std::uint32_t)asterisk});
+        }
+    }
+}
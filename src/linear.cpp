@@ -0,0 +1,116 @@
+#include "linear.hpp"
+#include "utils.hpp"
+#include <sstream>
+#include <stdexcept>
+
+void linear_form::axpy(const GiNaC::numeric& factor, const linear_form& other) {
+    if (factor.is_zero())
+        return;
+    constant += factor * other.constant;
+    if (other.indices.empty())
+        return;
+
+    // merge two sorted index lists
+    std::vector<int> merged_indices;
+    std::vector<GiNaC::numeric> merged_values;
+    merged_indices.reserve(indices.size() + other.indices.size());
+    merged_values.reserve(indices.size() + other.indices.size());
+    std::size_t i = 0, j = 0, m = indices.size(), n = other.indices.size();
+    while (i < m || j < n) {
+        if (j == n || (i < m && indices[i] < other.indices[j])) {
+            merged_indices.push_back(indices[i]);
+            merged_values.push_back(values[i++]);
+        } else if (i == m || other.indices[j] < indices[i]) {
+            merged_indices.push_back(other.indices[j]);
+            merged_values.push_back(factor * other.values[j++]);
+        } else {
+            GiNaC::numeric value = values[i] + factor * other.values[j];
+            if (!value.is_zero()) {
+                merged_indices.push_back(indices[i]);
+                merged_values.push_back(value);
+            }
+            i++, j++;
+        }
+    }
+    indices = std::move(merged_indices);
+    values = std::move(merged_values);
+}
+
+GiNaC::ex linear_form::to_ex(const GiNaC::lst& unknowns) const {
+    GiNaC::ex result = constant;
+    std::size_t n = indices.size();
+    for (std::size_t i = 0; i < n; i++) {
+        result += values[i] * unknowns[indices[i]];
+    }
+    return result;
+}
+
+GiNaC::ex linear_form::to_lst() const {
+    GiNaC::lst index_list, value_list;
+    std::size_t n = indices.size();
+    for (std::size_t i = 0; i < n; i++) {
+        index_list.append(indices[i]);
+        value_list.append(values[i]);
+    }
+    return GiNaC::lst{index_list, value_list, constant};
+}
+
+linear_form linear_form::from_lst(const GiNaC::ex& lst) {
+    linear_form form;
+    std::size_t n = lst.op(0).nops();
+    for (std::size_t i = 0; i < n; i++) {
+        form.indices.push_back(GiNaC::ex_to<GiNaC::numeric>(lst.op(0).op(i)).to_int());
+        form.values.push_back(GiNaC::ex_to<GiNaC::numeric>(lst.op(1).op(i)));
+    }
+    form.constant = lst.op(2);
+    return form;
+}
+
+linear_form to_linear_form(const GiNaC::ex& ex, const unknown_index& index) {
+    std::map<int, GiNaC::numeric> collected;
+    linear_form form;
+    GiNaC::ex expanded = ex.expand();
+    auto termp = polynomial_iterator(expanded), end = termp.end();
+    for (; termp != end; ++termp) {
+        GiNaC::ex term = *termp;
+        auto unknown = index.end();
+        if (GiNaC::is_a<GiNaC::symbol>(term)) {
+            unknown = index.find(term);
+        } else if (GiNaC::is_exactly_a<GiNaC::mul>(term)) {
+            for (auto factor: term) {
+                if (GiNaC::is_a<GiNaC::symbol>(factor)
+                 && (unknown = index.find(factor)) != index.end())
+                    break;
+            }
+        }
+        if (unknown == index.end()) {
+            // e.g. a power of an unknown, which is no factor of its own
+            for (auto& entry: index) {
+                if (term.has(entry.first)) {
+                    std::ostringstream message;
+                    message << "term " << term << " is not linear in "
+                            << GiNaC::ex_to<GiNaC::symbol>(entry.first).get_name();
+                    throw linear_form_error(message.str());
+                }
+            }
+            form.constant += term;
+            continue;
+        }
+
+        GiNaC::ex coefficient = term / unknown->first;
+        if (!GiNaC::is_exactly_a<GiNaC::numeric>(coefficient)) {
+            std::ostringstream message;
+            message << "non-numeric coefficient " << coefficient << " of "
+                    << GiNaC::ex_to<GiNaC::symbol>(unknown->first).get_name();
+            throw linear_form_error(message.str());
+        }
+        collected[unknown->second] += GiNaC::ex_to<GiNaC::numeric>(coefficient);
+    }
+    for (auto& entry: collected) {
+        if (entry.second.is_zero())
+            continue;
+        form.indices.push_back(entry.first);
+        form.values.push_back(entry.second);
+    }
+    return form;
+}
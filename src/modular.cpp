@@ -0,0 +1,409 @@
+#include "modular.hpp"
+#include "utils.hpp"
+
+// the largest primes below 2^63, so that sums of two residues fit into
+// 64 bits, and products into 128 bits
+static const std::uint64_t primes[] = {
+    9223372036854775783ULL,
+    9223372036854775643ULL,
+    9223372036854775549ULL,
+    9223372036854775507ULL,
+    9223372036854775433ULL,
+    9223372036854775421ULL,
+    9223372036854775417ULL,
+    9223372036854775399ULL,
+    9223372036854775351ULL,
+    9223372036854775337ULL,
+    9223372036854775291ULL,
+    9223372036854775279ULL,
+    9223372036854775259ULL,
+    9223372036854775181ULL,
+    9223372036854775159ULL,
+    9223372036854775139ULL
+};
+static const int num_primes = sizeof(primes) / sizeof(primes[0]);
+
+static std::uint64_t add_mod(std::uint64_t a, std::uint64_t b, std::uint64_t p) {
+    std::uint64_t sum = a + b;
+    return (sum >= p) ? sum - p : sum;
+}
+
+static std::uint64_t sub_mod(std::uint64_t a, std::uint64_t b, std::uint64_t p) {
+    return (a >= b) ? a - b : a + (p - b);
+}
+
+static std::uint64_t mul_mod(std::uint64_t a, std::uint64_t b, std::uint64_t p) {
+    return (unsigned __int128)a * b % p;
+}
+
+// a^(p-2), the inverse of a != 0 by Fermat's little theorem
+static std::uint64_t inverse_mod(std::uint64_t a, std::uint64_t p) {
+    std::uint64_t result = 1, e = p - 2;
+    while (e != 0) {
+        if (e & 1)
+            result = mul_mod(result, a, p);
+        a = mul_mod(a, a, p);
+        e >>= 1;
+    }
+    return result;
+}
+
+static std::uint64_t to_residue(const GiNaC::numeric& a, std::uint64_t p) {
+    return GiNaC::mod(a, GiNaC::numeric(p)).to_long();
+}
+
+static modular_series add(const modular_series& a, const modular_series& b, std::uint64_t p) {
+    modular_series sum;
+    sum.valuation = std::min(a.valuation, b.valuation);
+    int precision = std::min(a.precision(), b.precision());
+    for (int i = sum.valuation; i < precision; i++)
+        sum.coefficients.push_back(add_mod(a[i], b[i], p));
+    if (sum.coefficients.empty())
+        sum.valuation = precision;
+    return sum;
+}
+
+static modular_series multiply(const modular_series& a, const modular_series& b, std::uint64_t p) {
+    modular_series product;
+    product.valuation = a.valuation + b.valuation;
+    int n = std::min(a.coefficients.size(), b.coefficients.size());
+    product.coefficients.assign(n, 0);
+    for (int i = 0; i < n; i++) {
+        if (a.coefficients[i] == 0)
+            continue;
+        for (int j = 0; i + j < n; j++)
+            product.coefficients[i + j] = add_mod(product.coefficients[i + j],
+                                                  mul_mod(a.coefficients[i], b.coefficients[j], p), p);
+    }
+    return product;
+}
+
+// Rational reconstruction: the fraction a / b with |a|, |b| <= sqrt(m / 2)
+// and a = b x mod m, found by the extended Euclidean algorithm. Returns
+// false if there is none.
+static bool reconstruct(const GiNaC::numeric& x, const GiNaC::numeric& m, GiNaC::numeric& result) {
+    GiNaC::numeric bound = GiNaC::isqrt(GiNaC::iquo(m, 2));
+    GiNaC::numeric r0 = m, r1 = x, t0 = 0, t1 = 1;
+    while (r1 > bound) {
+        GiNaC::numeric q = GiNaC::iquo(r0, r1);
+        GiNaC::numeric r = r0 - q * r1, t = t0 - q * t1;
+        r0 = r1, r1 = r;
+        t0 = t1, t1 = t;
+    }
+    if (GiNaC::abs(t1) > bound || !(GiNaC::gcd(r1, t1) - 1).is_zero())
+        return false;
+    result = r1 / t1;
+    return true;
+}
+
+bool modular_expander::is_rational(const GiNaC::ex& f) {
+    if (GiNaC::is_exactly_a<GiNaC::numeric>(f))
+        return GiNaC::ex_to<GiNaC::numeric>(f).is_rational();
+    if (GiNaC::is_a<GiNaC::symbol>(f))
+        return f.is_equal(d);
+    if (GiNaC::is_exactly_a<GiNaC::add>(f) || GiNaC::is_exactly_a<GiNaC::mul>(f)) {
+        for (std::size_t i = 0; i < f.nops(); i++) {
+            if (!is_rational(f.op(i)))
+                return false;
+        }
+        return true;
+    }
+    if (GiNaC::is_exactly_a<GiNaC::power>(f))
+        return f.op(1).info(GiNaC::info_flags::integer) && is_rational(f.op(0));
+    return false;
+}
+
+modular_series modular_expander::evaluate(const GiNaC::ex& f, int n, std::uint64_t p) {
+    if (GiNaC::is_exactly_a<GiNaC::numeric>(f)) {
+        auto& c = GiNaC::ex_to<GiNaC::numeric>(f);
+        std::uint64_t denominator = to_residue(c.denom(), p);
+        if (denominator == 0)
+            throw bad_prime();
+        modular_series result;
+        result.valuation = 0;
+        result.coefficients.assign(n, 0);
+        result.coefficients[0] = mul_mod(to_residue(c.numer(), p), inverse_mod(denominator, p), p);
+        return result;
+    }
+
+    if (GiNaC::is_a<GiNaC::symbol>(f)) {
+        // d = d0 - 2 eps
+        modular_series result;
+        result.valuation = 0;
+        result.coefficients.assign(n, 0);
+        result.coefficients[0] = to_residue(d0, p);
+        if (n > 1)
+            result.coefficients[1] = p - 2;
+        return result;
+    }
+
+    if (GiNaC::is_exactly_a<GiNaC::add>(f)) {
+        auto result = evaluate(f.op(0), n, p);
+        for (std::size_t i = 1; i < f.nops(); i++)
+            result = add(result, evaluate(f.op(i), n, p), p);
+        return result;
+    }
+
+    if (GiNaC::is_exactly_a<GiNaC::mul>(f)) {
+        auto result = evaluate(f.op(0), n, p);
+        for (std::size_t i = 1; i < f.nops(); i++)
+            result = multiply(result, evaluate(f.op(i), n, p), p);
+        return result;
+    }
+
+    // a power with integer exponent, as checked by is_rational()
+    auto base = evaluate(f.op(0), n, p);
+    int exponent = GiNaC::ex_to<GiNaC::numeric>(f.op(1)).to_int();
+    if (exponent < 0) {
+        // strip leading zeros, so that the leading coefficient is
+        // invertible; a series vanishing modulo p is left to eps_expander
+        int leading = 0, m = base.coefficients.size();
+        while (leading < m && base.coefficients[leading] == 0)
+            leading++;
+        if (leading == m)
+            throw inconclusive();
+        modular_series inverse;
+        inverse.valuation = -(base.valuation + leading);
+        m -= leading;
+        const std::uint64_t* c = base.coefficients.data() + leading;
+        std::uint64_t c0_inverse = inverse_mod(c[0], p);
+        inverse.coefficients.push_back(c0_inverse);
+        for (int k = 1; k < m; k++) {
+            std::uint64_t sum = 0;
+            for (int j = 1; j <= k; j++)
+                sum = add_mod(sum, mul_mod(c[j], inverse.coefficients[k - j], p), p);
+            inverse.coefficients.push_back(mul_mod(sub_mod(0, sum, p), c0_inverse, p));
+        }
+        base = inverse;
+        exponent = -exponent;
+    }
+    modular_series result;
+    result.valuation = 0;
+    result.coefficients.assign(base.coefficients.size(), 0);
+    if (!result.coefficients.empty())
+        result.coefficients[0] = 1;
+    unsigned e = exponent;
+    while (e != 0) {
+        if (e & 1)
+            result = multiply(result, base, p);
+        e >>= 1;
+        if (e != 0)
+            base = multiply(base, base, p);
+    }
+    return result;
+}
+
+std::vector<modular_series> modular_expander::expand_terms(const std::vector<std::pair<GiNaC::ex, GiNaC::ex>>& terms,
+                                                           int n, std::uint64_t p) {
+    std::vector<modular_series> result;
+    for (auto& term: terms) {
+        auto series = evaluate(term.second, n, p);
+        int leading = 0, m = series.coefficients.size();
+        while (leading < m && series.valuation + leading < 0 && series.coefficients[leading] == 0)
+            leading++;
+        series.coefficients.erase(series.coefficients.begin(), series.coefficients.begin() + leading);
+        series.valuation += leading;
+        result.push_back(std::move(series));
+    }
+    return result;
+}
+
+bool modular_expander::expand(const GiNaC::ex& f, int order, const unknown_index& indices,
+                              std::vector<linear_form>& forms) {
+    // split f into the coefficients of the expansions, and the rest
+    std::map<GiNaC::ex, GiNaC::ex, GiNaC::ex_is_less> coefficients;
+    GiNaC::ex residual = 0;
+    auto termp = polynomial_iterator(f), end = termp.end();
+    for (; termp != end; ++termp) {
+        GiNaC::ex term = *termp, integral = 0, coefficient = 1;
+        if (GiNaC::is_a<GiNaC::symbol>(term) && expansions.find(term) != expansions.end()) {
+            integral = term;
+        } else if (GiNaC::is_exactly_a<GiNaC::mul>(term)) {
+            for (std::size_t i = 0; i < term.nops(); i++) {
+                GiNaC::ex factor = term.op(i);
+                if (integral.is_zero() && GiNaC::is_a<GiNaC::symbol>(factor)
+                 && expansions.find(factor) != expansions.end())
+                    integral = factor;
+                else
+                    coefficient *= factor;
+            }
+        }
+        if (!integral.is_zero() && is_rational(coefficient))
+            coefficients[integral] += coefficient;
+        else
+            residual += term;
+    }
+    // an integral that also appears in the rest is expanded with it
+    std::vector<std::pair<GiNaC::ex, GiNaC::ex>> terms;
+    for (auto& entry: coefficients) {
+        if (residual.has(entry.first))
+            residual += entry.first * entry.second;
+        else
+            terms.push_back(entry);
+    }
+    std::vector<GiNaC::ex> residual_coefficients;
+    if (!residual.is_zero() && !fallback.expand(residual, order, residual_coefficients))
+        return false;
+
+    // The coefficient of eps^k, k = 0, ..., order, is the sum over the
+    // terms c(d) I of [c]_(k - i) I_i, i = 0, ..., k. These residues are
+    // listed in the order of `targets`.
+    std::vector<int> target_orders;
+    std::vector<GiNaC::ex> targets;
+    std::vector<int> lengths;
+    for (auto& term: terms)
+        lengths.push_back(expansions[term.first].nops());
+    int num_terms = terms.size();
+    for (int k = 0; k <= order; k++) {
+        for (int j = 0; j < num_terms; j++) {
+            for (int i = 0; i <= k && i < lengths[j]; i++) {
+                target_orders.push_back(k);
+                targets.push_back(expansions[terms[j].first].op(i));
+            }
+        }
+    }
+    auto residues = [&lengths, num_terms, order](const std::vector<modular_series>& series) {
+        std::vector<std::uint64_t> result;
+        for (int k = 0; k <= order; k++) {
+            for (int j = 0; j < num_terms; j++) {
+                for (int i = 0; i <= k && i < lengths[j]; i++)
+                    result.push_back(series[j][k - i]);
+            }
+        }
+        return result;
+    };
+
+    std::size_t num_targets = targets.size();
+    std::vector<GiNaC::numeric> values;
+    try {
+        // Find the number of terms with the first prime that does not
+        // divide a denominator. Poles of factors cancel against zeros of
+        // others at the cost of precision, as in eps_expander.
+        int n = order + 1, q = 0;
+        const int max_terms = 16 * (order + 1);
+        std::vector<modular_series> series;
+        while (true) {
+            if (q == num_primes)
+                throw inconclusive();
+            try {
+                series = expand_terms(terms, n, primes[q]);
+            } catch (bad_prime& err) {
+                q++;
+                continue;
+            }
+            int precision = n;
+            bool pole = false;
+            for (auto& s: series) {
+                pole = pole || s.valuation < 0;
+                precision = std::min(precision, s.precision());
+            }
+            if (pole) {
+                // a residue that does not vanish modulo p does not vanish,
+                // unless an accidental zero shifted a valuation, so the
+                // pole is confirmed with another prime
+                for (int r = q + 1; r < num_primes; r++) {
+                    try {
+                        for (auto& s: expand_terms(terms, n, primes[r])) {
+                            if (s.valuation < 0)
+                                return false;
+                        }
+                        throw inconclusive();
+                    } catch (bad_prime& err) { }
+                }
+                throw inconclusive();
+            }
+            if (precision > order)
+                break;
+            n += order + 1 - precision;
+            if (n > max_terms)
+                throw inconclusive();
+        }
+
+        // Chinese remaindering, prime by prime, until the reconstructed
+        // rationals no longer change
+        std::vector<GiNaC::numeric> combined(num_targets, 0);
+        GiNaC::numeric modulus = 1;
+        int num_used = 0;
+        bool have_values = false, stable = false;
+        for (; q < num_primes && !stable; q++) {
+            std::uint64_t p = primes[q];
+            std::vector<std::uint64_t> current_residues;
+            if (num_used == 0) {
+                current_residues = residues(series);
+            } else {
+                try {
+                    auto other = expand_terms(terms, n, p);
+                    for (auto& s: other) {
+                        if (s.valuation < 0 || s.precision() <= order)
+                            throw inconclusive();
+                    }
+                    current_residues = residues(other);
+                } catch (bad_prime& err) {
+                    continue;
+                }
+            }
+            std::uint64_t modulus_inverse = inverse_mod(to_residue(modulus, p), p);
+            for (std::size_t e = 0; e < num_targets; e++) {
+                std::uint64_t t = mul_mod(sub_mod(current_residues[e], to_residue(combined[e], p), p),
+                                          modulus_inverse, p);
+                combined[e] += modulus * GiNaC::numeric(t);
+            }
+            modulus *= GiNaC::numeric(p);
+            num_used++;
+
+            std::vector<GiNaC::numeric> current(num_targets);
+            bool reconstructed = true;
+            for (std::size_t e = 0; e < num_targets && reconstructed; e++)
+                reconstructed = reconstruct(combined[e], modulus, current[e]);
+            if (reconstructed && have_values) {
+                stable = true;
+                for (std::size_t e = 0; e < num_targets && stable; e++)
+                    stable = (current[e] - values[e]).is_zero();
+            }
+            have_values = reconstructed;
+            values = std::move(current);
+        }
+        if (!stable)
+            throw inconclusive();
+    } catch (inconclusive& err) {
+        return expand_exactly(f, order, indices, forms);
+    }
+
+    forms.assign(order + 1, linear_form());
+    if (!residual.is_zero()) {
+        for (int k = 0; k <= order; k++)
+            forms[k] = to_linear_form(residual_coefficients[k], indices);
+    }
+    std::vector<std::map<int, GiNaC::numeric>> collected(order + 1);
+    std::vector<linear_form> modular_forms(order + 1);
+    for (std::size_t e = 0; e < num_targets; e++) {
+        if (values[e].is_zero())
+            continue;
+        auto unknown = indices.find(targets[e]);
+        if (unknown == indices.end())
+            modular_forms[target_orders[e]].constant += values[e] * targets[e];
+        else
+            collected[target_orders[e]][unknown->second] += values[e];
+    }
+    for (int k = 0; k <= order; k++) {
+        for (auto& entry: collected[k]) {
+            if (entry.second.is_zero())
+                continue;
+            modular_forms[k].indices.push_back(entry.first);
+            modular_forms[k].values.push_back(entry.second);
+        }
+        forms[k].axpy(1, modular_forms[k]);
+    }
+    return true;
+}
+
+bool modular_expander::expand_exactly(const GiNaC::ex& f, int order, const unknown_index& indices,
+                                      std::vector<linear_form>& forms) {
+    std::vector<GiNaC::ex> coefficients;
+    if (!fallback.expand(f, order, coefficients))
+        return false;
+    forms.clear();
+    for (auto& coefficient: coefficients)
+        forms.push_back(to_linear_form(coefficient, indices));
+    return true;
+}
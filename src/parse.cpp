@@ -1,58 +1,301 @@
 #include "utils.hpp"
 #include "parse.hpp"
+#include "pool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
 
+static const int slot_bits = 8;
+static const int slots_per_word = 64 / slot_bits;
+static const int max_slots = 2 * slots_per_word;
+static const int max_slot_value = (1 << slot_bits) - 1;
+// every entry of a quadratic form is a product of three polynomials, so
+// exponents up to 85 in each of them never overflow a slot
+static const int max_exponent = max_slot_value / 3;
 
-std::pair<bool, GiNaC::ex> polynomial_parser::parse(const GiNaC::ex& polynomial, bool matrix_input) {
-    if (matrix_input) {
-        auto matrix = GiNaC::ex_to<GiNaC::matrix>(polynomial);
-        int r = matrix.rows(), c = matrix.cols();
-        GiNaC::matrix result(r, c);
-        bool fail = false;
-        for (int i = 0; i < r; i++) {
-            if (fail)
-                break;
-            for (int j = 0; j < c; j++) {
-                if (fail)
-                    break;
-                auto output = parse(matrix(i, j), false);
-                if (!output.first)
-                    fail = true;
-                result(i, j) = output.second;
+monomial_key polynomial_parser::make_key(const std::vector<int>& exponents) {
+    monomial_key key{{0, 0}};
+    int n = exponents.size();
+    for (int s = 0; s < n; s++) {
+        key.words[s / slots_per_word] |= (std::uint64_t)exponents[s] << (s % slots_per_word * slot_bits);
+    }
+    return key;
+}
+
+GiNaC::ex polynomial_parser::monomial(const monomial_key& key) {
+    // slots hold the effective Feynman parameters, followed by L
+    int n = effective_feynman_paramsp->size();
+    GiNaC::ex result = 1;
+    for (int s = 0; s <= n; s++) {
+        int exponent = (key.words[s / slots_per_word] >> (s % slots_per_word * slot_bits)) & ((1 << slot_bits) - 1);
+        result *= GiNaC::pow(s < n ? (*feynman_paramsp)[(*effective_feynman_paramsp)[s]] : L, exponent);
+    }
+    return result;
+}
+
+void polynomial_parser::build_lookup_table() {
+    int n_params = feynman_paramsp->nops();
+    int n_effective = effective_feynman_paramsp->size();
+    if (n_effective + 1 > max_slots)
+        throw std::runtime_error("polynomial_parser: too many Feynman parameters");
+    std::vector<int> slot_of_param(n_params, -1);
+    for (int s = 0; s < n_effective; s++) {
+        slot_of_param[(*effective_feynman_paramsp)[s]] = s;
+    }
+
+    lookup_table.clear();
+    int orders = numeric_ibp_tablep->size();
+    for (int k = 0; k < orders; k++) {
+        GiNaC::numeric factor = GiNaC::factorial(k);
+        for (auto& entry: (*numeric_ibp_tablep)[k]) {
+            // only integrals with positive indices on all effective
+            // Feynman parameters, and no others, are reachable
+            auto& indices = entry.first;
+            if (indices.size() != n_params)
+                continue;
+            std::vector<int> exponents(n_effective + 1);
+            // products of factors reach any exponent that fits into a slot
+            bool reachable = (k <= max_slot_value);
+            for (int p = 0; p < n_params && reachable; p++) {
+                int s = slot_of_param[p];
+                if (s < 0)
+                    reachable = (indices[p] == 0);
+                else
+                    reachable = (indices[p] >= 1 && indices[p] - 1 <= max_slot_value);
+                if (reachable && s >= 0)
+                    exponents[s] = indices[p] - 1;
             }
+            if (!reachable)
+                continue;
+            exponents[n_effective] = k;
+            lookup_table[make_key(exponents)] = ibp_entry{&entry.second, factor};
         }
-        if (fail)
-            return std::make_pair(false, result);
-        
-        return std::make_pair(true, result);
     }
+    lookup_table_built = true;
+}
+
+bool polynomial_parser::to_monomials(const GiNaC::ex& polynomial, monomial_list& monomials) {
     GiNaC::ex expanded_polynomial = polynomial.expand();
+    int n_effective = effective_feynman_paramsp->size();
 
-    // parse each term of the expanded polynomial
-    GiNaC::ex generated_polynomial = 0;
+    monomials.clear();
     auto termp = polynomial_iterator(expanded_polynomial), end = termp.end();
-    try {
-        for (; termp != end; ++termp) {
-            std::vector<int> integral_indices(feynman_paramsp->nops(), 0);
-            int log_power;
-            GiNaC::ex term = *termp;
-            for (auto& i: *effective_feynman_paramsp) {
-                integral_indices[i] = term.degree((*feynman_paramsp)[i]) + 1;
-                term = term.lcoeff((*feynman_paramsp)[i]);
+    for (; termp != end; ++termp) {
+        std::vector<int> exponents(n_effective + 1);
+        GiNaC::ex term = *termp;
+        for (int s = 0; s < n_effective; s++) {
+            GiNaC::ex x = (*feynman_paramsp)[(*effective_feynman_paramsp)[s]];
+            exponents[s] = term.degree(x);
+            term = term.lcoeff(x);
+        }
+        exponents[n_effective] = term.degree(L);
+        term = term.lcoeff(L);
+        if (term.is_zero())
+            continue;
+        if (!GiNaC::is_exactly_a<GiNaC::numeric>(term)) {
+            std::cerr << "The term " << *termp << " has a non-numeric "
+                      << "coefficient!" << std::endl;
+            return false;
+        }
+        for (auto exponent: exponents) {
+            if (exponent < 0 || exponent > max_exponent) {
+                std::cerr << "The term " << *termp << " has an exponent "
+                          << "out of range!" << std::endl;
+                return false;
             }
-            std::string indices_repr = combine(integral_indices);
+        }
+        monomials.push_back(std::make_pair(make_key(exponents), GiNaC::ex_to<GiNaC::numeric>(term)));
+    }
+    return true;
+}
 
-            log_power = term.degree(L);
-            GiNaC::ex coeff = term.lcoeff(L) * GiNaC::tgamma(log_power + 1);
+bool polynomial_parser::accumulate(const monomial_key& key, const GiNaC::numeric& coefficient, linear_form& result) {
+    auto it = lookup_table.find(key);
+    if (it == lookup_table.end()) {
+        std::cerr << "The term " << monomial(key) << " corresponds to no entry "
+                  << "in the IBP table!" << std::endl;
+        return false;
+    }
+    result.axpy(coefficient * it->second.factor, *it->second.form);
+    return true;
+}
+
+bool polynomial_parser::parse_rows(const quadratic_form& form, int begin, int end, linear_block& result) {
+    int n = form.terms.size();
+    monomial_list prefactor;
+    std::vector<monomial_list> terms(n);
+    if (!to_monomials(form.prefactor, prefactor))
+        return false;
+    for (int i = begin; i < n; i++) {
+        if (!to_monomials(form.terms[i], terms[i]))
+            return false;
+    }
 
-            generated_polynomial += (coeff * numeric_ibp_tablep->at(log_power).at(indices_repr));
+    // entry (i, j) is the sum of the IBPs at the exponent sums of the
+    // monomials in prefactor * terms[i] and terms[j]
+    monomial_list row;
+    std::unordered_map<monomial_key, GiNaC::numeric, monomial_key_hash> merged;
+    for (int i = begin; i < end; i++) {
+        row.clear();
+        for (auto& a: prefactor) {
+            for (auto& b: terms[i])
+                row.push_back(std::make_pair(a.first + b.first, a.second * b.second));
         }
-    } catch (std::out_of_range& error) { // thrown by at()
-        std::cerr << "The term " << *termp << " corresponds to no entry "
-                  << "in the IBP table!" << std::endl;
+        for (int j = i; j < n; j++) {
+            // like monomials are merged first, so that those cancelling
+            // out need no entry in the IBP table
+            merged.clear();
+            for (auto& a: row) {
+                for (auto& b: terms[j])
+                    merged[a.first + b.first] += a.second * b.second;
+            }
+            auto& entry = result(i, j);
+            for (auto& m: merged) {
+                if (!m.second.is_zero() && !accumulate(m.first, m.second, entry))
+                    return false;
+            }
+        }
+    }
+    return true;
+}
+
+std::pair<bool, linear_block> polynomial_parser::parse(const quadratic_form& form) {
+    if (!lookup_table_built)
+        build_lookup_table();
+
+    linear_block result(form.terms.size());
+    if (!parse_rows(form, 0, form.terms.size(), result)) {
         std::cerr << "Polynomial parser exiting..." << std::endl;
-        return std::make_pair(false, (GiNaC::ex)0);
+        return std::make_pair(false, result);
+    }
+
+    return std::make_pair(true, result);
+}
+
+std::vector<linear_block> polynomial_parser::parse(const std::vector<quadratic_form>& forms) {
+    typedef std::chrono::duration<double, std::milli> milliseconds;
+    int num_forms = forms.size();
+    std::vector<linear_block> blocks;
+    if (!lookup_table_built)
+        build_lookup_table();
+
+    if (max_subprocesses <= 1) {
+        for (int k = 0; k < num_forms; k++) {
+            auto begin = std::chrono::high_resolution_clock::now();
+            auto parser_output = parse(forms[k]);
+            milliseconds time = std::chrono::high_resolution_clock::now() - begin;
+            std::cout << "Takes " << time.count() << " ms on parsing block " << k << std::endl;
+            if (parser_output.first)
+                blocks.push_back(std::move(parser_output.second));
+        }
+        return blocks;
+    }
+
+    // split every block into row ranges of about equal numbers of
+    // entries, a few ranges per worker
+    std::size_t total_entries = 0;
+    for (auto& form: forms) {
+        std::size_t n = form.terms.size();
+        total_entries += n * (n + 1) / 2;
+    }
+    std::size_t chunk_entries = std::max<std::size_t>(1, total_entries / (4 * max_subprocesses));
+    struct chunk {
+        int form, begin, end;
+    };
+    std::vector<chunk> chunks;
+    for (int k = 0; k < num_forms; k++) {
+        int n = forms[k].terms.size();
+        int begin = 0;
+        std::size_t entries = 0;
+        for (int i = 0; i < n; i++) {
+            entries += n - i;
+            if (entries >= chunk_entries || i == n - 1) {
+                chunks.push_back(chunk{k, begin, i + 1});
+                begin = i + 1;
+                entries = 0;
+            }
+        }
+    }
+
+    // workers send back the entries of their rows in packed order; an
+    // empty result means failure
+    worker_pool workers;
+    workers.start(max_subprocesses, [this, &forms, &chunks](const std::string& job) {
+        auto& c = chunks[std::stoi(job)];
+        std::vector<std::string> entries;
+        linear_block result(forms[c.form].terms.size());
+        if (!parse_rows(forms[c.form], c.begin, c.end, result))
+            return pack_strings(entries);
+        auto first = result.packed().begin() + result.row_begin(c.begin),
+             last = result.packed().begin() + result.row_begin(c.end);
+        for (; first != last; ++first)
+            entries.push_back(serialize(first->to_lst()));
+        return pack_strings(entries);
+    });
+
+    std::vector<linear_block> results;
+    std::vector<int> pending(num_forms, 0);
+    std::vector<bool> fail(num_forms, false);
+    std::vector<std::chrono::high_resolution_clock::time_point> begin_times(num_forms);
+    for (int k = 0; k < num_forms; k++)
+        results.push_back(linear_block(forms[k].terms.size()));
+    for (auto& c: chunks)
+        pending[c.form]++;
+
+    std::map<int, int> chunk_of_worker;
+    int num_chunks = chunks.size(), next = 0;
+    while (next < num_chunks || workers.busy() != 0) {
+        if (next < num_chunks && !workers.full()) {
+            if (chunks[next].begin == 0)
+                begin_times[chunks[next].form] = std::chrono::high_resolution_clock::now();
+            chunk_of_worker[workers.submit(std::to_string(next))] = next;
+            next++;
+            continue;
+        }
+        for (auto& finished: workers.collect(next == num_chunks)) {
+            auto& c = chunks[chunk_of_worker[finished.first]];
+            auto entries = unpack_strings(finished.second);
+            auto& packed = results[c.form].packed();
+            std::size_t offset = results[c.form].row_begin(c.begin);
+            if (entries.empty())
+                fail[c.form] = true;
+            // constants are numeric once expanded, so no symbols are needed
+            for (std::size_t e = 0; e < entries.size(); e++)
+                packed[offset + e] = linear_form::from_lst(deserialize(entries[e], GiNaC::lst()));
+            if (--pending[c.form] == 0) {
+                milliseconds time = std::chrono::high_resolution_clock::now() - begin_times[c.form];
+                std::cout << "Takes " << time.count() << " ms on parsing block " << c.form << std::endl;
+            }
+        }
     }
+    workers.stop();
 
-    return std::make_pair(true, generated_polynomial);
+    for (int k = 0; k < num_forms; k++) {
+        if (fail[k]) {
+            std::cerr << "Polynomial parser failed on block " << k << ", skipping..." << std::endl;
+            continue;
+        }
+        blocks.push_back(std::move(results[k]));
+    }
+    return blocks;
 }
 
+std::pair<bool, linear_form> polynomial_parser::parse(const GiNaC::ex& polynomial) {
+    if (!lookup_table_built)
+        build_lookup_table();
+
+    linear_form result;
+    monomial_list monomials;
+    bool fail = !to_monomials(polynomial, monomials);
+    for (auto& m: monomials) {
+        if (fail)
+            break;
+        fail = !accumulate(m.first, m.second, result);
+    }
+    if (fail) {
+        std::cerr << "Polynomial parser exiting..." << std::endl;
+        return std::make_pair(false, linear_form());
+    }
+
+    return std::make_pair(true, result);
+}
@@ -0,0 +1,155 @@
+#include "pool.hpp"
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <stdexcept>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+static bool read_all(int fd, char* buffer, std::size_t length) {
+    while (length > 0) {
+        ssize_t n = read(fd, buffer, length);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        buffer += n;
+        length -= n;
+    }
+    return true;
+}
+
+// fails with EPIPE once the reader is gone, as SIGPIPE is ignored
+static bool write_all(int fd, const char* buffer, std::size_t length) {
+    while (length > 0) {
+        ssize_t n = write(fd, buffer, length);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        buffer += n;
+        length -= n;
+    }
+    return true;
+}
+
+// frames are a 64-bit length followed by the payload
+static bool read_frame(int fd, std::string& payload) {
+    std::uint64_t length;
+    if (!read_all(fd, (char*)&length, sizeof(length)))
+        return false;
+    payload.resize(length);
+    return read_all(fd, payload.data(), length);
+}
+
+static bool write_frame(int fd, const std::string& payload) {
+    std::uint64_t length = payload.size();
+    return write_all(fd, (const char*)&length, sizeof(length))
+        && write_all(fd, payload.data(), length);
+}
+
+void worker_pool::start(int n, const handler& work) {
+    stop();
+    if (n < 1)
+        n = 1;
+    // avoid duplicating buffered output in the workers
+    std::cout.flush();
+    std::fflush(nullptr);
+    // a dead worker must make submit() throw rather than kill this process
+    std::signal(SIGPIPE, SIG_IGN);
+
+    for (int i = 0; i < n; i++) {
+        int job_pipe[2], result_pipe[2];
+        if (pipe(job_pipe) < 0 || pipe(result_pipe) < 0)
+            throw std::runtime_error("worker_pool::start(): cannot create pipes");
+        pid_t pid = fork();
+        if (pid < 0)
+            throw std::runtime_error("worker_pool::start(): cannot fork");
+        if (pid == 0) { // worker
+            close(job_pipe[1]);
+            close(result_pipe[0]);
+            for (auto& w: workers) {
+                close(w.job_fd);
+                close(w.result_fd);
+            }
+            std::string job;
+            try {
+                while (read_frame(job_pipe[0], job)) {
+                    if (!write_frame(result_pipe[1], work(job)))
+                        break;
+                }
+            } catch (std::exception& error) {
+                std::cerr << "Worker " << i << " failed: " << error.what() << std::endl;
+                _exit(1);
+            }
+            _exit(0);
+        }
+        close(job_pipe[0]);
+        close(result_pipe[1]);
+        workers.push_back(worker{pid, job_pipe[1], result_pipe[0], false});
+    }
+}
+
+void worker_pool::stop() {
+    for (auto& w: workers)
+        close(w.job_fd);
+    for (auto& w: workers) {
+        close(w.result_fd);
+        waitpid(w.pid, 0, 0);
+    }
+    workers.clear();
+    num_busy = 0;
+}
+
+int worker_pool::submit(const std::string& job) {
+    int n = workers.size();
+    for (int i = 0; i < n; i++) {
+        if (workers[i].busy)
+            continue;
+        if (!write_frame(workers[i].job_fd, job))
+            throw std::runtime_error("worker_pool::submit(): worker " + std::to_string(i) + " is gone");
+        workers[i].busy = true;
+        num_busy++;
+        return i;
+    }
+    throw std::runtime_error("worker_pool::submit(): no idle worker");
+}
+
+std::vector<std::pair<int, std::string>> worker_pool::collect(bool always_wait) {
+    std::vector<std::pair<int, std::string>> finished;
+    if (num_busy == 0)
+        return finished;
+
+    std::vector<pollfd> fds;
+    std::vector<int> indices;
+    int n = workers.size();
+    for (int i = 0; i < n; i++) {
+        if (workers[i].busy) {
+            fds.push_back(pollfd{workers[i].result_fd, POLLIN, 0});
+            indices.push_back(i);
+        }
+    }
+    int timeout = (always_wait || full()) ? -1 : 0;
+    int ready;
+    while ((ready = poll(fds.data(), fds.size(), timeout)) < 0 && errno == EINTR)
+        ;
+    if (ready <= 0)
+        return finished;
+
+    int num_fds = fds.size();
+    for (int k = 0; k < num_fds; k++) {
+        if (fds[k].revents == 0)
+            continue;
+        int i = indices[k];
+        std::string result;
+        if (!read_frame(workers[i].result_fd, result))
+            throw std::runtime_error("worker_pool::collect(): worker " + std::to_string(i) + " died");
+        workers[i].busy = false;
+        num_busy--;
+        finished.push_back(std::make_pair(i, std::move(result)));
+    }
+    return finished;
+}
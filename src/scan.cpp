@@ -0,0 +1,153 @@
+#include "scan.hpp"
+#include "utils.hpp"
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+
+point_result solve_point(config_parser& configure,
+                         const std::vector<quadratic_form>& polynomials,
+                         warm_start_point& warm_start) {
+    configure.expand_ibps();
+    if (configure.will_dump_raw_ibps) {
+        std::cerr << "Dumping raw IBPs ..." << std::endl;
+        std::ofstream raw_out(log_dir().append("raw_ibps"));
+        configure.dump_raw_ibps(raw_out);
+        raw_out.close();
+    }
+    if (configure.will_dump_expanded_ibps) {
+        std::cerr << "Dumping expanded IBPs ..." << std::endl;
+        std::ofstream expanded_out(log_dir().append("expanded_ibps"));
+        configure.dump_expanded_ibps(expanded_out);
+        expanded_out.close();
+    }
+
+    auto parser = configure.get_polynomial_parser();
+    START_TIME(parse_polynomials);
+    auto blocks = parser.parse(polynomials);
+    END_TIME(parse_polynomials);
+    PRINT_TIME(parse_polynomials);
+
+    if (blocks.size() == 0) {
+        std::cerr << "No available positivity constraints!" << std::endl;
+        return point_result{"no_constraints", GiNaC::lst()};
+    }
+
+    auto solver = configure.get_solver();
+    if (configure.will_warm_start)
+        solver.set_warm_start(warm_start);
+    solver.solve_from(blocks);
+    if (solver.get_warm_start())
+        warm_start = solver.get_warm_start();
+
+#ifndef NO_SDPA_LIB
+    if (solver.get_fail())
+        return point_result{"failed", GiNaC::lst()};
+
+    std::cout << "Computed master integral values are:" << std::endl;
+    std::cout << solver.get_result() << std::endl;
+    return point_result{"solved", solver.get_result()};
+#else
+    return point_result{"written", GiNaC::lst()};
+#endif // NO_SDPA_LIB
+}
+
+static std::string to_text(const GiNaC::ex& ex) {
+    std::ostringstream out;
+    out << ex;
+    return out.str();
+}
+
+std::string scan_scheduler::solve_scan_point(int k, warm_start_point& warm_start) {
+    auto& configure = *configurep;
+    auto& point = configure.scan_points()[k];
+    std::cerr << "Kinematic point " << k + 1 << " / " << configure.scan_points().size() << std::endl;
+    // every point keeps its logs apart
+    auto base_log_dir = log_dir();
+    set_log_dir(std::filesystem::path(base_log_dir).append("point_" + std::to_string(k + 1)));
+
+    point_result result;
+    try {
+        configure.set_kinematics(point);
+        std::cout << "Kinematics: " << configure.kinematics() << std::endl;
+#ifndef NO_GSL
+        if (configure.will_check_euclidean && !configure.check_euclidean(0, configure.euclidean_trials))
+            result.status = "not_euclidean";
+        else
+#endif // NO_GSL
+            result = solve_point(configure, polynomials, warm_start);
+    } catch (std::exception& error) {
+        std::cerr << "Kinematic point " << k + 1 << " failed: " << error.what() << std::endl;
+        result = point_result{"failed", GiNaC::lst()};
+    }
+    set_log_dir(base_log_dir);
+
+    YAML::Emitter record;
+    record << YAML::BeginMap;
+    record << YAML::Key << "point" << YAML::Value << k + 1;
+    record << YAML::Key << "kinematics" << YAML::Value << YAML::BeginMap;
+    for (auto rule: point)
+        record << YAML::Key << to_text(rule.lhs()) << YAML::Value << to_text(rule.rhs());
+    record << YAML::EndMap;
+    record << YAML::Key << "status" << YAML::Value << result.status;
+    if (result.values.nops() > 0) {
+        record << YAML::Key << "values" << YAML::Value << YAML::BeginMap;
+        for (auto rule: result.values)
+            record << YAML::Key << to_text(rule.lhs()) << YAML::Value << to_double(rule.rhs());
+        record << YAML::EndMap;
+    }
+    record << YAML::EndMap;
+    return record.c_str();
+}
+
+void scan_scheduler::run(const std::filesystem::path& output) {
+    auto& configure = *configurep;
+    int num_points = configure.scan_points().size();
+    configure.read_ibps();
+    auto generator = configure.get_polynomial_parser().get_polynomial_generator();
+    polynomials = generator.generate_from_config();
+
+    std::vector<std::string> records(num_points);
+    int workers_used = std::min(num_workers, num_points);
+    if (workers_used <= 1) {
+        warm_start_point warm_start;
+        for (int k = 0; k < num_points; k++)
+            records[k] = solve_scan_point(k, warm_start);
+    } else {
+        // worker processes get copies of the IBP relations and the
+        // ansatze, and split the subprocess budget among them
+        int budget = std::max(1, configure.subprocesses() / workers_used);
+        // every worker process keeps its own copy of the last solution
+        auto warm_start = std::make_shared<warm_start_point>();
+        worker_pool pool;
+        pool.start(workers_used, [this, budget, warm_start](const std::string& job) {
+            configurep->set_subprocesses(budget);
+            return solve_scan_point(std::stoi(job), *warm_start);
+        });
+        std::map<int, int> point_of_worker;
+        auto collect = [&](bool always_wait) {
+            for (auto& finished: pool.collect(always_wait)) {
+                int k = point_of_worker[finished.first];
+                records[k] = finished.second;
+                std::cerr << "Finished kinematic point " << k + 1 << std::endl;
+            }
+        };
+        for (int k = 0; k < num_points; k++) {
+            if (pool.full())
+                collect(false);
+            point_of_worker[pool.submit(std::to_string(k))] = k;
+        }
+        while (pool.busy() != 0)
+            collect(true);
+        pool.stop();
+    }
+
+    YAML::Emitter out;
+    out << YAML::BeginSeq;
+    for (auto& record: records)
+        out << YAML::Load(record);
+    out << YAML::EndSeq;
+    std::ofstream output_file(output);
+    output_file << out.c_str() << std::endl;
+    std::cout << "Scan results are written to " << output.string() << std::endl;
+}
@@ -1,13 +1,101 @@
 #include "sdpa.hpp"
 #include "utils.hpp"
+#include <algorithm>
+#include <cmath>
+
+// write the matrices b and A_i of "b + Lambda + x_i A_i >= 0" entry by
+// entry, reading every entry off the linear form it belongs to
+static void write_symbolic_sdp(std::ostream& out, const std::vector<linear_block>& blocks, int num_unknowns) {
+    int nBlock = blocks.size();
+    out << "b + Lambda";
+    for (int i = 0; i < num_unknowns; i++)
+        out << " + x" << i << " A" << i;
+    out << " >= 0" << std::endl << std::endl;
+
+    // i < 0 stands for b
+    for (int i = -1; i < num_unknowns; i++) {
+        if (i < 0)
+            out << "b = {" << std::endl;
+        else
+            out << "A" << i << " = {" << std::endl;
+        for (int j = 0; j < nBlock; j++) {
+            int n = blocks[j].size();
+            out << "    {{";
+            for (int k = 0; k < n; k++) {
+                for (int l = 0; l < n; l++) {
+                    auto& form = blocks[j](k, l);
+                    if (i < 0) {
+                        out << form.constant;
+                    } else {
+                        auto it = std::lower_bound(form.indices.begin(), form.indices.end(), i);
+                        if (it != form.indices.end() && *it == i)
+                            out << form.values[it - form.indices.begin()];
+                        else
+                            out << 0;
+                    }
+                    if (l != n - 1)
+                        out << ", ";
+                }
+                if (k != n - 1)
+                    out << "},\n     {";
+                else
+                    out << "}}," << std::endl;
+            }
+            out << std::endl;
+        }
+        out << "}" << std::endl << std::endl;
+    }
+}
 
 #ifndef NO_SDPA_LIB
 
-sdpa_interface::sdpa_interface(const std::vector<std::vector<GiNaC::matrix>>& coefficients,
-                               const std::vector<GiNaC::matrix>& bias,
-                               const YAML::Node& config) {
+// whether a solution fits a problem with the given unknowns and blocks
+static bool fits_problem(const sdpa_result& point, int nMasters,
+                         const std::vector<int>& block_sizes) {
+    int nBlock = block_sizes.size();
+    if ((int)point.x_vec.size() != nMasters + 1
+     || (int)point.x_mat.size() != nBlock || (int)point.y_mat.size() != nBlock)
+        return false;
+    for (int j = 0; j < nBlock; j++) {
+        std::size_t n = block_sizes[j];
+        if (point.x_mat[j].size() != n * n || point.y_mat[j].size() != n * n)
+            return false;
+    }
+    return true;
+}
+
+// An optimal solution lies on the boundary of the cone, while SDPA needs
+// an interior initial point, so both matrices are shifted by a multiple
+// of the identity.
+static void input_init_matrix(SDPA& problem, int block, int n, const std::vector<double>& matrix, bool primal) {
+    double trace = 0;
+    for (int k = 0; k < n; k++)
+        trace += matrix[k * n + k];
+    double shift = 1e-2 * std::max(1.0, std::abs(trace) / n);
+    for (int k = 0; k < n; k++) {
+        for (int l = k; l < n; l++) {
+            double value = matrix[k * n + l] + (k == l ? shift : 0.0);
+            if (value == 0.0)
+                continue;
+            if (primal)
+                problem.inputInitXMat(block, k + 1, l + 1, value);
+            else
+                problem.inputInitYMat(block, k + 1, l + 1, value);
+        }
+    }
+}
+
+sdpa_interface::sdpa_interface(const std::vector<std::vector<sparse_block>>& coefficients,
+                               const std::vector<sparse_block>& bias,
+                               const std::vector<int>& block_sizes,
+                               const YAML::Node& config,
+                               const sdpa_result* warm_start) {
     std::cerr << "SDPA start working..." << std::endl;
     fail = false;
+    if (warm_start != nullptr && !fits_problem(*warm_start, coefficients.size(), block_sizes)) {
+        std::cerr << "Previous solution does not fit the problem, starting from scratch" << std::endl;
+        warm_start = nullptr;
+    }
 
     problem.setDisplay(nullptr);
     problem.setParameterType(SDPA::PARAMETER_DEFAULT);
@@ -56,14 +144,16 @@ sdpa_interface::sdpa_interface(const std::vector<std::vector<GiNaC::matrix>>& co
             std::cerr << "Set gammaStar = " << sdpa_params["gammaStar"].as<double>() << std::endl;
         }
     }
+    if (warm_start != nullptr)
+        problem.setInitPoint(true);
     problem.printParameters(stdout);
 
     int nMasters = coefficients.size();
-    int nBlock = bias.size();
+    int nBlock = block_sizes.size();
     problem.inputConstraintNumber(nMasters + 1);
     problem.inputBlockNumber(nBlock);
     for (int i = 0; i < nBlock; i++) {
-        problem.inputBlockSize(i + 1, bias[i].rows());
+        problem.inputBlockSize(i + 1, block_sizes[i]);
         problem.inputBlockType(i + 1, SDPA::SDP);
     }
     problem.initializeUpperTriangleSpace();
@@ -73,107 +163,42 @@ sdpa_interface::sdpa_interface(const std::vector<std::vector<GiNaC::matrix>>& co
     }
     problem.inputCVec(nMasters + 1, 1);
 
+    // only non-zero entries are passed to SDPA, which allocates space
+    // for every entry it is given
     for (int j = 0; j < nBlock; j++) {
-        int n = bias[j].rows();
-        bias_matrices.push_back(std::vector<std::vector<GiNaC::ex>>(n, std::vector<GiNaC::ex>(n)));
-        for (int k = 0; k < n; k++) {
-            for (int l = k; l < n; l++) {
-                auto element = bias[j](k, l);
-                double value = 0.0;
-                try {
-                    value = -to_double(element);
-                } catch (...) {
-                    std::cerr << element << " is not a numeric value!" << std::endl;
-                    fail = true;
-                }
-                problem.inputElement(0, j + 1, k + 1, l + 1, value);
-                bias_matrices.back()[k][l] = element;
-                bias_matrices.back()[l][k] = element;
-            }
-        }
+        for (auto& entry: bias[j])
+            problem.inputElement(0, j + 1, entry.row, entry.col, -entry.value);
     }
 
     for (int i = 0; i < nMasters; i++) {
-        coefficient_matrices.push_back(std::vector<std::vector<std::vector<GiNaC::ex>>>(nBlock));
         for (int j = 0; j < nBlock; j++) {
-            int n = coefficients[i][j].rows();
-            coefficient_matrices.back()[j] = std::vector<std::vector<GiNaC::ex>>(n, std::vector<GiNaC::ex>(n));
-            for (int k = 0; k < n; k++) {
-                for (int l = k; l < n; l++) {
-                    auto element = coefficients[i][j](k, l);
-                    double value = 0.0;
-                    try {
-                        value = to_double(element);
-                    } catch (...) {
-                        std::cerr << element << " is not a numeric value!" << std::endl;
-                        fail = true;
-                    }
-                    problem.inputElement(i + 1, j + 1, k + 1, l + 1, value);
-                    coefficient_matrices.back()[j][k][l] = element;
-                    coefficient_matrices.back()[j][l][k] = element;
-                }
-            }
+            for (auto& entry: coefficients[i][j])
+                problem.inputElement(i + 1, j + 1, entry.row, entry.col, entry.value);
         }
     }
 
     for (int j = 0; j < nBlock; j++) {
-        int n = bias[j].rows();
-        for (int k = 0; k < n; k++) {
+        for (int k = 0; k < block_sizes[j]; k++) {
             problem.inputElement(nMasters + 1, j + 1, k + 1, k + 1, 1);
         }
     }
 
     problem.initializeUpperTriangle();
-    problem.initializeSolve();
-}
-
-void sdpa_interface::dump(std::ostream& out) {
-    int nVariable = coefficient_matrices.size();
-    int nBlock = bias_matrices.size();
-    out << "b + Lambda";
-    for (int i = 0; i < nVariable; i++)
-        out << " + x" << i << " A" << i;
-    out << " >= 0" << std::endl << std::endl;
-
-    out << "b = {" << std::endl;
-    for (int j = 0; j < nBlock; j++) {
-        int n = bias_matrices[j].size();
-        out << "    {{";
-        for (int k = 0; k < n; k++) {
-            for (int l = 0; l < n; l++) {
-                out << bias_matrices[j][k][l];
-                if (l != n - 1)
-                    out << ", ";
-            }
-            if (k != n - 1)
-                out << "},\n     {";
-            else
-                out << "}}," << std::endl;
-        }
-        out << std::endl;
-    }
-    out << "}" << std::endl << std::endl;
-
-    for (int i = 0; i < nVariable; i++) {
-        out << "A" << i << " = {" << std::endl;
+    if (warm_start != nullptr) {
+        std::cerr << "Starting from the previous solution" << std::endl;
+        for (int i = 0; i <= nMasters; i++)
+            problem.inputInitXVec(i + 1, warm_start->x_vec[i]);
         for (int j = 0; j < nBlock; j++) {
-            int n = coefficient_matrices[i][j].size();
-            out << "    {{";
-            for (int k = 0; k < n; k++) {
-                for (int l = 0; l < n; l++) {
-                    out << coefficient_matrices[i][j][k][l];
-                    if (l != n - 1)
-                        out << ", ";
-                }
-                if (k != n - 1)
-                    out << "},\n     {";
-                else
-                    out << "}}," << std::endl;
-            }
-            out << std::endl;
+            int n = block_sizes[j];
+            input_init_matrix(problem, j + 1, n, warm_start->x_mat[j], true);
+            input_init_matrix(problem, j + 1, n, warm_start->y_mat[j], false);
         }
-        out << "}" << std::endl << std::endl;
     }
+    problem.initializeSolve();
+}
+
+void sdpa_interface::dump(std::ostream& out, const std::vector<linear_block>& blocks, int num_unknowns) {
+    write_symbolic_sdp(out, blocks, num_unknowns);
 }
 
 void sdpa_interface::solve() {
@@ -198,6 +223,15 @@ void sdpa_interface::solve() {
     for (int i = 0; i < n; i++) {
         result.x_vec[i] = raw_x_vec[i];
     }
+    int nBlock = problem.getBlockNumber();
+    result.x_mat.clear();
+    result.y_mat.clear();
+    for (int j = 0; j < nBlock; j++) {
+        int size = problem.getBlockSize(j + 1);
+        auto raw_x_mat = problem.getResultXMat(j + 1), raw_y_mat = problem.getResultYMat(j + 1);
+        result.x_mat.push_back(std::vector<double>(raw_x_mat, raw_x_mat + size * size));
+        result.y_mat.push_back(std::vector<double>(raw_y_mat, raw_y_mat + size * size));
+    }
 }
 
 sdpa_interface::~sdpa_interface() {
@@ -206,18 +240,130 @@ sdpa_interface::~sdpa_interface() {
 
 #else
 
+#include <charconv>
 #include <fstream>
 #include <filesystem>
 
-sdpa_interface::sdpa_interface(const std::vector<std::vector<GiNaC::matrix>>& coefficients,
-                               const std::vector<GiNaC::matrix>& bias,
+// write a block in the dense format, zeros included
+static void write_dense_block(std::ostream& out, const sparse_block& entries, int n, double sign) {
+    std::vector<double> dense(n * n, 0.0);
+    for (auto& entry: entries) {
+        dense[(entry.row - 1) * n + entry.col - 1] = sign * entry.value;
+        dense[(entry.col - 1) * n + entry.row - 1] = sign * entry.value;
+    }
+    out << "{ ";
+    for (int k = 0; k < n; k++) {
+        if (k == 0)
+            out << "{";
+        else 
+            out << "},\n  {";
+        for (int l = 0; l < n; l++) {
+            out << dense[k * n + l];
+            if (l != n - 1)
+                out << ", ";
+        }
+    }
+    out << "} }" << std::endl;
+}
+
+// buffered writer for the sparse SDPA format, formatting numbers with
+// std::to_chars rather than through streams
+class sparse_problem_writer {
+public:
+    sparse_problem_writer(const std::filesystem::path& path) : out(path, std::ios::binary) {
+        buffer.reserve(capacity + 128);
+    }
+    ~sparse_problem_writer() {
+        flush();
+    }
+
+    void write(const char* text) {
+        buffer += text;
+    }
+
+    void write(int value) {
+        char digits[16];
+        auto end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+        buffer.append(digits, end);
+    }
+
+    // one line "matno blkno i j value"
+    void write_entry(int matrix, int block, const sparse_entry& entry) {
+        write(matrix);
+        buffer += ' ';
+        write(block);
+        buffer += ' ';
+        write(entry.row);
+        buffer += ' ';
+        write(entry.col);
+        buffer += ' ';
+        char digits[32];
+        // shortest representation that reads back to the same double
+        auto end = std::to_chars(digits, digits + sizeof(digits), entry.value).ptr;
+        buffer.append(digits, end);
+        buffer += '\n';
+        if (buffer.size() >= capacity)
+            flush();
+    }
+
+    void flush() {
+        out.write(buffer.data(), buffer.size());
+        buffer.clear();
+    }
+
+private:
+    static const std::size_t capacity = 1 << 20;
+    std::ofstream out;
+    std::string buffer;
+};
+
+// Write the SDP in the sparse SDPA format, with only the non-zero
+// upper-triangle entries of every block.
+static void write_sparse_problem(const std::filesystem::path& path,
+                                 const std::vector<std::vector<sparse_block>>& coefficients,
+                                 const std::vector<sparse_block>& bias,
+                                 const std::vector<int>& block_sizes) {
+    int nMasters = coefficients.size();
+    int nBlock = block_sizes.size();
+    sparse_problem_writer writer(path);
+    writer.write(nMasters + 1);
+    writer.write(" = mDIM\n");
+    writer.write(nBlock);
+    writer.write(" = nBLOCK\n");
+    for (int j = 0; j < nBlock; j++) {
+        writer.write(block_sizes[j]);
+        writer.write(" ");
+    }
+    writer.write("= bLOCKsTRUCT\n");
+    for (int i = 0; i < nMasters; i++)
+        writer.write("0 ");
+    writer.write("1\n");
+
+    for (int j = 0; j < nBlock; j++) {
+        for (auto& entry: bias[j])
+            writer.write_entry(0, j + 1, sparse_entry{entry.row, entry.col, -entry.value});
+    }
+    for (int i = 0; i < nMasters; i++) {
+        for (int j = 0; j < nBlock; j++) {
+            for (auto& entry: coefficients[i][j])
+                writer.write_entry(i + 1, j + 1, entry);
+        }
+    }
+    for (int j = 0; j < nBlock; j++) {
+        for (int k = 1; k <= block_sizes[j]; k++)
+            writer.write_entry(nMasters + 1, j + 1, sparse_entry{k, k, 1.0});
+    }
+}
+
+sdpa_interface::sdpa_interface(const std::vector<std::vector<sparse_block>>& coefficients,
+                               const std::vector<sparse_block>& bias,
+                               const std::vector<int>& block_sizes,
                                const YAML::Node& config) {
     std::cerr << "SDPA start working..." << std::endl;
     fail = false;
 
 
-    std::filesystem::create_directory("logs");
-    std::ofstream param_file(std::filesystem::path("logs").append("param.sdpa"));
+    std::ofstream param_file(log_dir().append("param.sdpa"));
 
     // set custom SDPA parameters
     if (has_non_null_key(config, "sdpa_params")) {
@@ -309,14 +455,21 @@ sdpa_interface::sdpa_interface(const std::vector<std::vector<GiNaC::matrix>>& co
     }
     param_file.close();
 
-    std::ofstream problem_file(std::filesystem::path("logs").append("problem.in"));
+    if (has_non_null_key(config, "options") && has_non_null_key(config["options"], "sparse_problem_file")
+            && config["options"]["sparse_problem_file"].as<bool>()) {
+        write_sparse_problem(log_dir().append("problem.dat-s"), coefficients, bias, block_sizes);
+        return;
+    }
+
+    std::ofstream problem_file(log_dir().append("problem.in"));
+    problem_file.precision(17);
     int nMasters = coefficients.size();
-    int nBlock = bias.size();
+    int nBlock = block_sizes.size();
     problem_file << "    " << (nMasters + 1) << " = mDIM" << std::endl;
     problem_file << "    " << nBlock << " = nBLOCK" << std::endl;
     problem_file << "    ";
     for (int i = 0; i < nBlock; i++)
-        problem_file << bias[i].rows() << "    ";
+        problem_file << block_sizes[i] << "    ";
     problem_file << " = bLOCKsTRUCT" << std::endl;
 
     problem_file << "{";
@@ -326,71 +479,20 @@ sdpa_interface::sdpa_interface(const std::vector<std::vector<GiNaC::matrix>>& co
     problem_file << "1}" << std::endl;
 
     problem_file << "{" << std::endl;
-    for (int j = 0; j < nBlock; j++) {
-        int n = bias[j].rows();
-        bias_matrices.push_back(std::vector<std::vector<GiNaC::ex>>(n, std::vector<GiNaC::ex>(n)));
-        problem_file << "{ ";
-        for (int k = 0; k < n; k++) {
-            if (k == 0)
-                problem_file << "{";
-            else 
-                problem_file << "},\n  {";
-            for (int l = 0; l < n; l++) {
-                auto element = bias[j](k, l);                
-                double value = 0.0;
-                try {
-                    value = -to_double(element);
-                    problem_file << GiNaC::ex_to<GiNaC::numeric>(-element).evalf();
-                } catch (...) {
-                    std::cerr << element << " is not a numeric value!" << std::endl;
-                    fail = true;
-                }
-                if (l != n - 1)
-                    problem_file << ", ";
-                bias_matrices.back()[k][l] = element;
-                bias_matrices.back()[l][k] = element;
-            }
-        }
-        problem_file << "} }" << std::endl;
-    }
+    for (int j = 0; j < nBlock; j++)
+        write_dense_block(problem_file, bias[j], block_sizes[j], -1.0);
     problem_file << "}" << std::endl;
 
     for (int i = 0; i < nMasters; i++) {
-        coefficient_matrices.push_back(std::vector<std::vector<std::vector<GiNaC::ex>>>(nBlock));
         problem_file << "{" << std::endl;
-        for (int j = 0; j < nBlock; j++) {
-            int n = coefficients[i][j].rows();
-            coefficient_matrices.back()[j] = std::vector<std::vector<GiNaC::ex>>(n, std::vector<GiNaC::ex>(n));
-            problem_file << "{ ";
-            for (int k = 0; k < n; k++) {
-                if (k == 0)
-                    problem_file << "{";
-                else 
-                    problem_file << "},\n  {";
-                for (int l = 0; l < n; l++) {
-                    auto element = coefficients[i][j](k, l);
-                    double value = 0.0;
-                    try {
-                        value = to_double(element);
-                        problem_file << GiNaC::ex_to<GiNaC::numeric>(element).evalf();
-                    } catch (...) {
-                        std::cerr << element << " is not a numeric value!" << std::endl;
-                        fail = true;
-                    }
-                    if (l != n - 1)
-                        problem_file << ", ";
-                    coefficient_matrices.back()[j][k][l] = element;
-                    coefficient_matrices.back()[j][l][k] = element;
-                }
-            }
-            problem_file << "} }" << std::endl;
-        }
+        for (int j = 0; j < nBlock; j++)
+            write_dense_block(problem_file, coefficients[i][j], block_sizes[j], 1.0);
         problem_file << "}" << std::endl;
     }
 
     problem_file << "{" << std::endl;
     for (int j = 0; j < nBlock; j++) {
-        int n = bias[j].rows();
+        int n = block_sizes[j];
         problem_file << "{ ";
         for (int k = 0; k < n; k++) {
             if (k == 0)
@@ -413,53 +515,8 @@ sdpa_interface::sdpa_interface(const std::vector<std::vector<GiNaC::matrix>>& co
     problem_file.close();
 }
 
-void sdpa_interface::dump(std::ostream& out) {
-    int nVariable = coefficient_matrices.size();
-    int nBlock = bias_matrices.size();
-    out << "b + Lambda";
-    for (int i = 0; i < nVariable; i++)
-        out << " + x" << i << " A" << i;
-    out << " >= 0" << std::endl << std::endl;
-
-    out << "b = {" << std::endl;
-    for (int j = 0; j < nBlock; j++) {
-        int n = bias_matrices[j].size();
-        out << "    {{";
-        for (int k = 0; k < n; k++) {
-            for (int l = 0; l < n; l++) {
-                out << bias_matrices[j][k][l];
-                if (l != n - 1)
-                    out << ", ";
-            }
-            if (k != n - 1)
-                out << "},\n     {";
-            else
-                out << "}}," << std::endl;
-        }
-        out << std::endl;
-    }
-    out << "}" << std::endl << std::endl;
-
-    for (int i = 0; i < nVariable; i++) {
-        out << "A" << i << " = {" << std::endl;
-        for (int j = 0; j < nBlock; j++) {
-            int n = coefficient_matrices[i][j].size();
-            out << "    {{";
-            for (int k = 0; k < n; k++) {
-                for (int l = 0; l < n; l++) {
-                    out << coefficient_matrices[i][j][k][l];
-                    if (l != n - 1)
-                        out << ", ";
-                }
-                if (k != n - 1)
-                    out << "},\n     {";
-                else
-                    out << "}}," << std::endl;
-            }
-            out << std::endl;
-        }
-        out << "}" << std::endl << std::endl;
-    }
+void sdpa_interface::dump(std::ostream& out, const std::vector<linear_block>& blocks, int num_unknowns) {
+    write_symbolic_sdp(out, blocks, num_unknowns);
 }
 
 void sdpa_interface::solve() {
@@ -0,0 +1,220 @@
+#include "series.hpp"
+
+static bool is_zero_coefficient(const GiNaC::ex& c) {
+    if (GiNaC::is_exactly_a<GiNaC::numeric>(c))
+        return c.is_zero();
+    return c.expand().is_zero();
+}
+
+eps_series operator+(const eps_series& a, const eps_series& b) {
+    eps_series sum;
+    sum.valuation = std::min(a.valuation, b.valuation);
+    int precision = std::min(a.precision(), b.precision());
+    for (int i = sum.valuation; i < precision; i++)
+        sum.coefficients.push_back(a[i] + b[i]);
+    if (sum.coefficients.empty())
+        sum.valuation = precision;
+    return sum;
+}
+
+eps_series operator*(const eps_series& a, const eps_series& b) {
+    eps_series product;
+    product.valuation = a.valuation + b.valuation;
+    int n = std::min(a.coefficients.size(), b.coefficients.size());
+    product.coefficients.assign(n, 0);
+    for (int i = 0; i < n; i++) {
+        if (a.coefficients[i].is_zero())
+            continue;
+        for (int j = 0; i + j < n; j++) {
+            if (!b.coefficients[j].is_zero())
+                product.coefficients[i + j] += a.coefficients[i] * b.coefficients[j];
+        }
+    }
+    return product;
+}
+
+eps_series inverse(const eps_series& a) {
+    // strip leading zeros, so that the leading coefficient is invertible
+    int leading = 0, n = a.coefficients.size();
+    while (leading < n && is_zero_coefficient(a.coefficients[leading]))
+        leading++;
+    if (leading == n)
+        throw eps_series_error();
+
+    eps_series result;
+    result.valuation = -(a.valuation + leading);
+    n -= leading;
+    const GiNaC::ex* c = a.coefficients.data() + leading;
+    GiNaC::ex c0_inverse = 1 / c[0];
+    result.coefficients.push_back(c0_inverse);
+    for (int k = 1; k < n; k++) {
+        GiNaC::ex sum = 0;
+        for (int j = 1; j <= k; j++) {
+            if (!c[j].is_zero())
+                sum += c[j] * result.coefficients[k - j];
+        }
+        result.coefficients.push_back(-sum * c0_inverse);
+    }
+    return result;
+}
+
+eps_series pow(const eps_series& a, int exponent) {
+    eps_series base = (exponent < 0) ? inverse(a) : a;
+    unsigned e = (exponent < 0) ? -exponent : exponent;
+    eps_series result;
+    result.valuation = 0;
+    result.coefficients.assign(base.coefficients.size(), 0);
+    if (!result.coefficients.empty())
+        result.coefficients[0] = 1;
+    while (true) {
+        if (e & 1)
+            result = result * base;
+        e >>= 1;
+        if (e == 0)
+            break;
+        base = base * base;
+    }
+    return result;
+}
+
+eps_series eps_expander::constant(const GiNaC::ex& c, int n) {
+    eps_series result;
+    result.valuation = 0;
+    result.coefficients.assign(n, 0);
+    result.coefficients[0] = c;
+    return result;
+}
+
+bool eps_expander::numeric_polynomial(const GiNaC::ex& f, std::vector<GiNaC::numeric>& coefficients) {
+    coefficients.clear();
+    for (auto term: f) {
+        GiNaC::ex power = term, factor = 1;
+        if (GiNaC::is_exactly_a<GiNaC::mul>(term)) {
+            if (term.nops() != 2 || !GiNaC::is_exactly_a<GiNaC::numeric>(term.op(1)))
+                return false;
+            power = term.op(0);
+            factor = term.op(1);
+        }
+        int degree;
+        if (GiNaC::is_exactly_a<GiNaC::numeric>(power)) {
+            factor = power;
+            degree = 0;
+        } else if (power.is_equal(d)) {
+            degree = 1;
+        } else if (GiNaC::is_exactly_a<GiNaC::power>(power) && power.op(0).is_equal(d)
+                   && power.op(1).info(GiNaC::info_flags::integer)) {
+            degree = GiNaC::ex_to<GiNaC::numeric>(power.op(1)).to_int();
+        } else {
+            return false;
+        }
+        if (degree < 0)
+            return false;
+        if ((int)coefficients.size() <= degree)
+            coefficients.resize(degree + 1, 0);
+        coefficients[degree] += GiNaC::ex_to<GiNaC::numeric>(factor);
+    }
+    return true;
+}
+
+eps_series eps_expander::evaluate_polynomial(const std::vector<GiNaC::numeric>& coefficients, int n) {
+    // Horner in d = d0 - 2 eps, on exact numbers rather than expressions:
+    // s <- s * (d0 - 2 eps) + c_k
+    std::vector<GiNaC::numeric> s(n, 0);
+    for (int k = coefficients.size() - 1; k >= 0; k--) {
+        for (int i = n - 1; i > 0; i--)
+            s[i] = d0 * s[i] - 2 * s[i - 1];
+        s[0] = d0 * s[0] + coefficients[k];
+    }
+    eps_series result;
+    result.valuation = 0;
+    result.coefficients.assign(s.begin(), s.end());
+    return result;
+}
+
+eps_series eps_expander::evaluate(const GiNaC::ex& f, int n) {
+    if (GiNaC::is_exactly_a<GiNaC::numeric>(f))
+        return constant(f, n);
+
+    if (GiNaC::is_a<GiNaC::symbol>(f)) {
+        if (f.is_equal(d)) {
+            auto result = constant(d0, n);
+            if (n > 1)
+                result.coefficients[1] = -2;
+            return result;
+        }
+        auto it = expansions.find(f);
+        if (it == expansions.end())
+            return constant(f, n);
+        // the expansion is taken as an exact polynomial in eps
+        eps_series result;
+        result.valuation = 0;
+        result.coefficients.assign(n, 0);
+        int m = std::min(n, (int)it->second.nops());
+        for (int i = 0; i < m; i++)
+            result.coefficients[i] = it->second.op(i);
+        return result;
+    }
+
+    if (GiNaC::is_exactly_a<GiNaC::add>(f)) {
+        std::vector<GiNaC::numeric> polynomial;
+        if (numeric_polynomial(f, polynomial))
+            return evaluate_polynomial(polynomial, n);
+        auto result = evaluate(f.op(0), n);
+        for (std::size_t i = 1; i < f.nops(); i++)
+            result = result + evaluate(f.op(i), n);
+        return result;
+    }
+
+    if (GiNaC::is_exactly_a<GiNaC::mul>(f)) {
+        auto result = evaluate(f.op(0), n);
+        for (std::size_t i = 1; i < f.nops(); i++)
+            result = result * evaluate(f.op(i), n);
+        return result;
+    }
+
+    if (GiNaC::is_exactly_a<GiNaC::power>(f) && f.op(1).info(GiNaC::info_flags::integer))
+        return pow(evaluate(f.op(0), n), GiNaC::ex_to<GiNaC::numeric>(f.op(1)).to_int());
+
+    if (!f.has(d))
+        return constant(f, n);
+
+    // not rational in d, e.g. Gamma functions in known master integrals
+    auto full = f.subs(d == d0 - 2 * eps, GiNaC::subs_options::algebraic);
+    auto poly = GiNaC::series_to_poly(full.series(eps == 0, n));
+    eps_series result;
+    result.valuation = std::min(poly.ldegree(eps), 0);
+    for (int i = result.valuation; i < n; i++)
+        result.coefficients.push_back(poly.coeff(eps, i));
+    return result;
+}
+
+bool eps_expander::expand(const GiNaC::ex& f, int order, std::vector<GiNaC::ex>& coefficients) {
+    // poles of individual factors cancel against zeros of others at the
+    // cost of precision, so retry with more terms until enough are left
+    int n = order + 1;
+    const int max_terms = 16 * (order + 1);
+    while (n <= max_terms) {
+        eps_series result;
+        try {
+            result = evaluate(f, n);
+        } catch (eps_series_error& err) {
+            return false;
+        } catch (GiNaC::pole_error& err) {
+            return false;
+        }
+        int leading = 0, m = result.coefficients.size();
+        while (leading < m && result.valuation + leading < 0
+            && is_zero_coefficient(result.coefficients[leading]))
+            leading++;
+        if (leading < m && result.valuation + leading < 0)
+            return false;
+        if (result.precision() > order) {
+            coefficients.clear();
+            for (int i = 0; i <= order; i++)
+                coefficients.push_back(result[i].expand());
+            return true;
+        }
+        n += order + 1 - result.precision();
+    }
+    return false;
+}
@@ -0,0 +1,56 @@
+#include "simplex.hpp"
+#include <algorithm>
+#include <cmath>
+
+void project_to_simplex(std::vector<double>& x) {
+    int n = x.size();
+    std::vector<double> sorted(x);
+    std::sort(sorted.begin(), sorted.end(), std::greater<double>());
+    // find the largest k such that sorted[k-1] stays positive after
+    // shifting the first k entries to sum up to 1
+    double sum = 0, theta = 0;
+    for (int k = 1; k <= n; k++) {
+        sum += sorted[k - 1];
+        double shift = (sum - 1) / k;
+        if (sorted[k - 1] - shift > 0)
+            theta = shift;
+    }
+    for (auto& value: x)
+        value = std::max(value - theta, 0.0);
+}
+
+double minimize_on_simplex(const simplex_objective& f, std::vector<double>& x,
+                           int max_iterations, double stop_below) {
+    int n = x.size();
+    std::vector<double> gradient(n), trial(n), trial_gradient(n);
+    double value = f(x, gradient);
+    double step = 1;
+    for (int iteration = 0; iteration < max_iterations && value >= stop_below; iteration++) {
+        bool moved = false;
+        while (step > 1e-16) {
+            for (int i = 0; i < n; i++)
+                trial[i] = x[i] - step * gradient[i];
+            project_to_simplex(trial);
+            // first-order decrease along the projected step; none means
+            // that x is stationary
+            double decrease = 0;
+            for (int i = 0; i < n; i++)
+                decrease += gradient[i] * (x[i] - trial[i]);
+            if (!(decrease > 0))
+                break;
+            double trial_value = f(trial, trial_gradient);
+            if (trial_value <= value - 1e-4 * decrease) {
+                x.swap(trial);
+                gradient.swap(trial_gradient);
+                value = trial_value;
+                step *= 2;
+                moved = true;
+                break;
+            }
+            step /= 2;
+        }
+        if (!moved)
+            break;
+    }
+    return value;
+}
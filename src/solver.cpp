@@ -1,83 +1,72 @@
 #include "solver.hpp"
 #include "sdpa.hpp"
 #include "utils.hpp"
-#include "config.hpp"
-#include <time.h>
 #include <fstream>
 #include <filesystem>
 
-static bool all_zero(const GiNaC::matrix& matrix) {
-    int r = matrix.rows(), c = matrix.cols();
-    for (int i = 0; i < r; i++) {
-        for (int j = 0; j < c; j++) {
-            if (!(matrix(i, j) == 0))
-                return false;
-        }
-    }
-    return true;
-}
-
-void master_solver::solve_from(const std::vector<GiNaC::matrix>& matrices, void* config_parserp) {
+void master_solver::solve_from(const std::vector<linear_block>& blocks) {
     START_TIME(solve);
     fail = false;
-    int num_blocks = matrices.size();
+    int num_blocks = blocks.size();
     int num_integrals = variables_to_solve.nops();
-    config_parser* configurep = (config_parser*)config_parserp;
-    time_t now;
-    time(&now);
-    std::cerr << "Current time: " << now << std::endl;
 
-    std::filesystem::create_directory("logs");
-    std::ofstream variables_out(std::filesystem::path("logs").append("variables_to_solve"));
+    std::ofstream variables_out(log_dir().append("variables_to_solve"));
     variables_out << variables_to_solve << std::endl;
     variables_out.close();
 
-    std::vector<std::vector<GiNaC::matrix>> coefficients;
-    for (int i = 0; i < num_integrals; i++) {
-        coefficients.push_back(std::vector<GiNaC::matrix>(num_blocks));
-    }
-    std::vector<GiNaC::matrix> bias(num_blocks);
-    GiNaC::lst zero_rules;
-    for (auto& integral: variables_to_solve) {
-        zero_rules.append(integral == 0);
-    }
-
+    // entries are linear in the unknowns, so a single pass over them
+    // collects the non-zero entries of all coefficient matrices and of
+    // the bias, without building the matrices themselves
     std::cerr << "Start generating SDP problem ..." << std::endl;
-    int total_matrices = (num_integrals + 1) * num_blocks, cnt = 0;
-    for (int i = 0; i < num_integrals; i++) {
-        for (int j = 0; j < num_blocks; j++) {
-            if (configurep->working_subprocesses == configurep->max_subprocesses) {
-                configurep->generate_subprocess_yield(false, now, &coefficients, &bias);
-            }
-            std::cerr << "Processing " << ++cnt << "-th / " << total_matrices << " matrix" << "\r";
-            configurep->generate_subprocess_work(i, j, now, matrices[j], zero_rules, GiNaC::ex_to<GiNaC::symbol>(variables_to_solve[i]));
-        }
-    }
+    std::vector<std::vector<sparse_block>> coefficients(num_integrals, std::vector<sparse_block>(num_blocks));
+    std::vector<sparse_block> bias(num_blocks);
+    std::vector<int> block_sizes;
+    std::vector<bool> determined(num_integrals, false);
+    bool numeric = true;
     for (int j = 0; j < num_blocks; j++) {
-        if (configurep->working_subprocesses == configurep->max_subprocesses) {
-            configurep->generate_subprocess_yield(false, now, &coefficients, &bias);
+        int n = blocks[j].size();
+        block_sizes.push_back(n);
+        auto& entries = blocks[j].packed();
+        std::size_t e = 0;
+        for (int k = 0; k < n; k++) {
+            for (int l = k; l < n; l++, e++) {
+                auto& form = entries[e];
+                std::size_t terms = form.indices.size();
+                for (std::size_t t = 0; t < terms; t++) {
+                    coefficients[form.indices[t]][j].push_back(sparse_entry{k + 1, l + 1, form.values[t].to_double()});
+                    determined[form.indices[t]] = true;
+                }
+                if (form.constant.is_zero())
+                    continue;
+                GiNaC::ex value = form.constant.evalf();
+                if (GiNaC::is_a<GiNaC::numeric>(value) && GiNaC::ex_to<GiNaC::numeric>(value).is_real()) {
+                    bias[j].push_back(sparse_entry{k + 1, l + 1, GiNaC::ex_to<GiNaC::numeric>(value).to_double()});
+                } else {
+                    std::cerr << form.constant << " is not a numeric value!" << std::endl;
+                    numeric = false;
+                }
+            }
         }
-        std::cerr << "Processing " << ++cnt << "-th / " << total_matrices << " matrix" << "\r";
-        configurep->generate_subprocess_work(-1, j, now, matrices[j], zero_rules, GiNaC::symbol("#####placeholder#####"));
     }
-    while (configurep->working_subprocesses != 0)
-        configurep->generate_subprocess_yield(true, now, &coefficients, &bias);
-
-    std::cerr << std::endl;
 
     for (int i = 0; i < num_integrals; i++) {
-        bool zero = true;
-        for (int j = 0; j < num_blocks; j++) {
-            zero &= all_zero(coefficients[i][j]);
-        }
-        if (zero) {
+        if (!determined[i]) {
             std::cerr << "Warning: " << variables_to_solve[i] << " cannot be determined" << std::endl;
         }
     }
+    if (!numeric) {
+        fail = true;
+        std::cerr << "SDP problem is not numeric!" << std::endl;
+        return;
+    }
     std::cerr << "Finished generating SDP problem!" << std::endl;
 
     // instantiate an SDPA solver
-    sdpa_interface solve(coefficients, bias, *configp);
+#ifndef NO_SDPA_LIB
+    sdpa_interface solve(coefficients, bias, block_sizes, *configp, warm_start.get());
+#else
+    sdpa_interface solve(coefficients, bias, block_sizes, *configp);
+#endif // NO_SDPA_LIB
     if (solve.get_fail()) {
         fail = true;
         std::cerr << "SDPA failed at initialization!" << std::endl;
@@ -86,18 +75,24 @@ void master_solver::solve_from(const std::vector<GiNaC::matrix>& matrices, void*
 
     if (will_dump) {
         std::cerr << "Dumping symbolic SDP ..." << std::endl;
-        std::filesystem::create_directory("logs");
-        std::ofstream sdp_out(std::filesystem::path("logs").append("symbolic_sdp"));
-        solve.dump(sdp_out);
+        std::ofstream sdp_out(log_dir().append("symbolic_sdp"));
+        solve.dump(sdp_out, blocks, num_integrals);
         sdp_out.close();
     }
+    // SDPA holds its own copy of the problem by now, so the entries are
+    // not kept alive through the solve
+    coefficients = std::vector<std::vector<sparse_block>>();
+    bias = std::vector<sparse_block>();
     solve.solve();
     END_TIME(solve);
     PRINT_TIME(solve);
 
 #ifndef NO_SDPA_LIB
     auto& result = solve.get_result();
-    if (result.phase != SDPA::PhaseType::pdOPT) {
+    std::cerr << "SDPA iterations: " << result.stop_iteration << std::endl;
+    if (result.phase == SDPA::PhaseType::pdOPT) {
+        solution = std::make_shared<sdpa_result>(result);
+    } else {
         fail = true;
         std::cerr << "SDPA failed after trying to solve!" << std::endl;
         return;
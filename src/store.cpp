@@ -0,0 +1,121 @@
+#include "store.hpp"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// index records are laid out as
+//      [uint32 key length][uint64 offset][uint64 length][key]
+static const std::size_t index_header = sizeof(std::uint32_t) + 2 * sizeof(std::uint64_t);
+
+void cache_store::open(const std::string& path) {
+    close();
+    pack_fd = ::open((path + ".pack").c_str(), O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+    index_fd = ::open((path + ".index").c_str(), O_RDWR | O_CREAT | O_APPEND, S_IRUSR | S_IWUSR);
+    if (pack_fd < 0 || index_fd < 0)
+        throw std::runtime_error("cache_store::open(): cannot open " + path);
+
+    struct stat st;
+    fstat(pack_fd, &st);
+    pack_size = st.st_size;
+    fstat(index_fd, &st);
+    std::vector<char> buffer(st.st_size);
+    std::size_t size = 0;
+    while (size < buffer.size()) {
+        ssize_t n = pread(index_fd, buffer.data() + size, buffer.size() - size, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        size += n;
+    }
+
+    // later records override earlier ones; a torn record at the end
+    // (e.g. after an interrupted run) is dropped
+    std::size_t pos = 0;
+    while (pos + index_header <= size) {
+        std::uint32_t key_length;
+        location loc;
+        std::memcpy(&key_length, buffer.data() + pos, sizeof(key_length));
+        std::memcpy(&loc.offset, buffer.data() + pos + sizeof(key_length), sizeof(loc.offset));
+        std::memcpy(&loc.length, buffer.data() + pos + sizeof(key_length) + sizeof(loc.offset), sizeof(loc.length));
+        if (pos + index_header + key_length > size || loc.offset + loc.length > pack_size)
+            break;
+        index[std::string(buffer.data() + pos + index_header, key_length)] = loc;
+        pos += index_header + key_length;
+    }
+    if (pos != size)
+        (void)!ftruncate(index_fd, pos);
+}
+
+void cache_store::open_in_memory() {
+    close();
+    in_memory = true;
+}
+
+void cache_store::close() {
+    if (pack_fd >= 0)
+        ::close(pack_fd);
+    if (index_fd >= 0)
+        ::close(index_fd);
+    pack_fd = index_fd = -1;
+    pack_size = 0;
+    index.clear();
+    in_memory = false;
+    values.clear();
+}
+
+std::string cache_store::load(const std::string& key) const {
+    if (in_memory) {
+        auto it = values.find(key);
+        if (it == values.end())
+            throw std::runtime_error("cache_store::load(): no entry " + key);
+        return it->second;
+    }
+    auto it = index.find(key);
+    if (it == index.end())
+        throw std::runtime_error("cache_store::load(): no entry " + key);
+    std::string value(it->second.length, '\0');
+    std::size_t size = 0;
+    while (size < value.size()) {
+        ssize_t n = pread(pack_fd, value.data() + size, value.size() - size, it->second.offset + size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            throw std::runtime_error("cache_store::load(): cannot read entry " + key);
+        size += n;
+    }
+    return value;
+}
+
+void cache_store::save(const std::string& key, const std::string& value) {
+    if (in_memory) {
+        values[key] = value;
+        return;
+    }
+    location loc{pack_size, value.size()};
+    std::size_t size = 0;
+    while (size < value.size()) {
+        ssize_t n = pwrite(pack_fd, value.data() + size, value.size() - size, loc.offset + size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            throw std::runtime_error("cache_store::save(): cannot write entry " + key);
+        size += n;
+    }
+    pack_size += value.size();
+
+    std::uint32_t key_length = key.size();
+    std::string record(index_header + key.size(), '\0');
+    std::memcpy(record.data(), &key_length, sizeof(key_length));
+    std::memcpy(record.data() + sizeof(key_length), &loc.offset, sizeof(loc.offset));
+    std::memcpy(record.data() + sizeof(key_length) + sizeof(loc.offset), &loc.length, sizeof(loc.length));
+    std::memcpy(record.data() + index_header, key.data(), key.size());
+    // a single append keeps the record whole in the index
+    if (write(index_fd, record.data(), record.size()) != (ssize_t)record.size())
+        throw std::runtime_error("cache_store::save(): cannot index entry " + key);
+    index[key] = loc;
+}
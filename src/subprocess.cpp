@@ -1,134 +1,150 @@
 #include "config.hpp"
 #include "utils.hpp"
-#include <sys/wait.h>
 #include <functional>
 
-void config_parser::read_subprocess_work(const std::string& key, const std::string& integral, const std::string& coefficient) {
-    pid_t pid = fork();
-    if (pid == 0) { // subprocess
-        GiNaC::parser coefficient_reader(symbol_table);
-        auto ex = coefficient_reader(coefficient);
-        if (kinematics_numerics.nops() > 0) {
-            ex = ex.subs(kinematics_numerics, GiNaC::subs_options::algebraic);
+void config_parser::read_subprocess_start() {
+    // one parser per worker, rather than one per coefficient
+    auto coefficient_reader = std::make_shared<GiNaC::parser>(symbol_table);
+    GiNaC::lst rules = read_stage_numerics();
+    bool symbolic = symbolic_kinematics;
+    workers.start(max_subprocesses, [coefficient_reader, rules, symbolic](const std::string& job) {
+        GiNaC::lst batch;
+        for (auto& coefficient: unpack_strings(job))
+            batch.append((*coefficient_reader)(coefficient));
+        GiNaC::ex exs = batch;
+        if (rules.nops() > 0) {
+            exs = exs.subs(rules, GiNaC::subs_options::algebraic);
         }
-        save_to_read_cache(key, integral, ex);
-        exit(0);
-    } else {
-        working_subprocesses++;
-        read_subprocess_map[pid] = std::make_pair(key, integral);
-    }
+        std::vector<std::string> results;
+        // coefficients with symbolic kinematics are normalized once
+        // here, so that they can be compiled when loaded
+        for (auto ex: exs) {
+            if (symbolic) {
+                GiNaC::ex fraction = ex.numer_denom();
+                ex = GiNaC::lst{fraction.op(0).expand(), fraction.op(1).expand()};
+            }
+            results.push_back(serialize(ex));
+        }
+        return pack_strings(results);
+    });
+    read_batch_relations = 0;
+}
+
+void config_parser::read_subprocess_work(const integral_index& key, const integral_index& integral, const std::string& coefficient) {
+    read_batch.push_back(std::make_pair(key, integral));
+    read_batch_coefficients.push_back(coefficient);
+}
+
+void config_parser::read_subprocess_next_relation(const read_callback& callback) {
+    if (read_batch_relations == read_batch_size)
+        read_subprocess_submit(callback);
+    read_batch_relations++;
 }
 
-void config_parser::read_mainprocess_work(const std::string& key, const std::string& integral) {
+void config_parser::read_subprocess_submit(const read_callback& callback) {
+    read_batch_relations = 0;
+    if (read_batch.empty())
+        return;
+    if (workers.full())
+        read_subprocess_yield(false, callback);
+    int worker = workers.submit(pack_strings(read_batch_coefficients));
+    read_subprocess_map[worker] = std::move(read_batch);
+    read_batch.clear();
+    read_batch_coefficients.clear();
+}
+
+void config_parser::read_mainprocess_work(const integral_index& key, const integral_index& integral) {
     auto current_integral = get(integral_table, integral, "I[", "]")
         .subs(master_values, GiNaC::subs_options::algebraic)
-        .subs(kinematics_numerics, GiNaC::subs_options::algebraic);
+        .subs(read_stage_numerics(), GiNaC::subs_options::algebraic);
     auto prefactor = get_prefactor(key, t, num_internals, symbol_table["d"],
                                    sector_designate, top_level_sector).second;
+    if (symbolic_kinematics) {
+        // the coefficient is evaluated at every kinematic point
+        auto fraction = load_from_read_cache(key, integral);
+        GiNaC::symbol d = GiNaC::ex_to<GiNaC::symbol>(symbol_table["d"]);
+        symbolic_relations[key].push_back(symbolic_term{
+            current_integral * prefactor * ibp_sign(key, integral),
+            compiled_rational(fraction.op(0), fraction.op(1), d, kinematic_variables)
+        });
+        return;
+    }
     ibp_table[key] += (current_integral * prefactor * read_ibp_simple(key, integral));
 }
 
-void config_parser::read_subprocess_yield(bool always_wait, const std::function<void(const std::string&, const std::string&)>& callback) {
-    pid_t pid;
-    int flag = always_wait ? 0 :
-        ((working_subprocesses == max_subprocesses) ? 0 : WNOHANG);
-    while ((pid = waitpid(-1, 0, flag)) > 0) {
-        working_subprocesses--;
-        auto key_integral = read_subprocess_map[pid];
-        auto key = key_integral.first, integral = key_integral.second;
-        callback(key, integral);
-        read_subprocess_map.erase(pid);
-        flag = always_wait ? 0 :
-            ((working_subprocesses == max_subprocesses) ? 0 : WNOHANG);
+void config_parser::read_subprocess_yield(bool always_wait, const read_callback& callback) {
+    for (auto& finished: workers.collect(always_wait)) {
+        auto& entries = read_subprocess_map[finished.first];
+        auto coefficients = unpack_strings(finished.second);
+        int n = entries.size();
+        for (int i = 0; i < n; i++) {
+            save_to_read_cache(entries[i].first, entries[i].second, coefficients[i]);
+            callback(entries[i].first, entries[i].second);
+        }
+        read_subprocess_map.erase(finished.first);
     }
 }
 
-void config_parser::expand_subprocess_work(const std::string& key, const GiNaC::ex& coefficient, const GiNaC::lst& rules, int order, const GiNaC::symbol& eps) {
-    pid_t pid = fork();
-    if (pid == 0) { // subprocess
-        auto full = coefficient.subs(rules, GiNaC::subs_options::algebraic);
-        GiNaC::lst derivatives;
-        int fail = 0;
-        for (int i = 0; i <= order; i++) {
-            try {
-                derivatives.append(full.subs(eps == 0, GiNaC::subs_options::algebraic));
-            } catch (GiNaC::pole_error& err) {
-                fail = 1;
-                break;
+// Expand an IBP relation into serialized linear forms, one per order.
+// Relations with a pole at eps = 0 are dropped. A relation that is not
+// linear in the unknowns gives an empty string followed by the reason,
+// since serialized forms are never empty.
+static std::string expand_relation(eps_expander& expander, modular_expander* modular,
+                                   const GiNaC::ex& ibp, const unknown_index& indices, int order) {
+    std::vector<GiNaC::ex> coefficients;
+    std::vector<std::string> forms;
+    try {
+        if (modular != nullptr) {
+            std::vector<linear_form> expanded;
+            if (modular->expand(ibp, order, indices, expanded)) {
+                for (auto& form: expanded)
+                    forms.push_back(serialize(form.to_lst()));
             }
-            if (i != order)
-                full = full.diff(eps);
+            return pack_strings(forms);
         }
-        if (fail)
-            save_to_expand_cache(key, GiNaC::lst());
-        else
-            save_to_expand_cache(key, derivatives);
-        exit(0);
-    } else {
-        working_subprocesses++;
-        expand_subprocess_map[pid] = key;
+        if (!expander.expand(ibp, order, coefficients))
+            return pack_strings(forms);
+        for (auto& coefficient: coefficients)
+            forms.push_back(serialize(to_linear_form(coefficient, indices).to_lst()));
+    } catch (linear_form_error& err) {
+        return pack_strings({"", err.what()});
     }
+    return pack_strings(forms);
 }
 
-void config_parser::expand_mainprocess_work(const std::string& key) {
-    auto lst = GiNaC::ex_to<GiNaC::lst>(load_from_expand_cache(key));
-    int order = lst.nops();
-    if (order == 0)
-        return;
-    
-    for (int i = 0; i < order; i++) {
-        numeric_ibp_table[i][key] = lst[i] / GiNaC::tgamma(i + 1);
-    }
+void config_parser::expand_subprocess_start(const std::map<GiNaC::ex, GiNaC::lst, GiNaC::ex_is_less>& expansions, int order) {
+    GiNaC::symbol d = GiNaC::ex_to<GiNaC::symbol>(symbol_table["d"]);
+    auto expander = std::make_shared<eps_expander>(d, d0, expansions);
+    std::shared_ptr<modular_expander> modular;
+    if (modular_expansion)
+        modular = std::make_shared<modular_expander>(d, d0, expansions);
+    workers.start(max_subprocesses, [this, expander, modular, order](const std::string& job) {
+        return expand_relation(*expander, modular.get(), ibp_table[integral_index::from_raw(job)],
+                               unknown_indices, order);
+    });
 }
 
-void config_parser::expand_subprocess_yield(bool always_wait) {
-    pid_t pid;
-    int flag = always_wait ? 0 :
-        ((working_subprocesses == max_subprocesses) ? 0 : WNOHANG);
-    while ((pid = waitpid(-1, 0, flag)) > 0) {
-        working_subprocesses--;
-        auto key = expand_subprocess_map[pid];
-        expand_mainprocess_work(key);
-        expand_subprocess_map.erase(pid);
-        flag = always_wait ? 0 :
-            ((working_subprocesses == max_subprocesses) ? 0 : WNOHANG);
-    }
+void config_parser::expand_subprocess_work(const integral_index& key) {
+    int worker = workers.submit(key.raw());
+    expand_subprocess_map[worker] = key;
 }
 
-void config_parser::generate_subprocess_work(int integral, int block, time_t timestamp, const GiNaC::matrix& raw_matrix, const GiNaC::lst& rules, const GiNaC::symbol& integral_symbol) {
-    pid_t pid = fork();
-    if (pid == 0) { // subprocess
-        if (integral != -1) // coefficient
-            save_to_generate_cache(integral, block, timestamp, GiNaC::ex_to<GiNaC::matrix>(raw_matrix.diff(integral_symbol).subs(rules, GiNaC::subs_options::algebraic)));
-        else // bias
-            save_to_generate_cache(integral, block, timestamp, GiNaC::ex_to<GiNaC::matrix>(((GiNaC::ex)raw_matrix).subs(rules, GiNaC::subs_options::algebraic)));
-        exit(0);
-    } else {
-        working_subprocesses++;
-        generate_subprocess_map[pid] = std::make_pair(integral, block);
-    }
-}
-
-void config_parser::generate_mainprocess_work(int integral, int block, time_t timestamp, std::vector<std::vector<GiNaC::matrix>>* coefficient, std::vector<GiNaC::matrix>* bias) {
-    if (integral == -1) { // bias
-        (*bias)[block] = load_from_generate_cache(integral, block, timestamp);
-    } else { // coefficient
-        (*coefficient)[integral][block] = load_from_generate_cache(integral, block, timestamp);
+void config_parser::expand_mainprocess_work(const integral_index& key) {
+    auto forms = load_from_expand_cache(key);
+    int order = forms.size();
+    for (int i = 0; i < order; i++) {
+        numeric_ibp_table[i][key] = std::move(forms[i]);
     }
 }
 
-void config_parser::generate_subprocess_yield(bool always_wait, time_t timestamp, std::vector<std::vector<GiNaC::matrix>>* coefficient, std::vector<GiNaC::matrix>* bias) {
-    pid_t pid;
-    int flag = always_wait ? 0 :
-        ((working_subprocesses == max_subprocesses) ? 0 : WNOHANG);
-    while ((pid = waitpid(-1, 0, flag)) > 0) {
-        working_subprocesses--;
-        auto pair = generate_subprocess_map[pid];
-        int integral = pair.first, block = pair.second;
-        generate_mainprocess_work(integral, block, timestamp, coefficient, bias);
-        generate_subprocess_map.erase(pid);
-        flag = always_wait ? 0 :
-            ((working_subprocesses == max_subprocesses) ? 0 : WNOHANG);
+void config_parser::expand_subprocess_yield(bool always_wait) {
+    for (auto& finished: workers.collect(always_wait)) {
+        auto key = expand_subprocess_map[finished.first];
+        auto forms = unpack_strings(finished.second);
+        if (!forms.empty() && forms[0].empty())
+            throw std::runtime_error("expand_ibps(): IBP relation of " + key.to_string() + ": " + forms[1]);
+        save_to_expand_cache(key, finished.second);
+        expand_mainprocess_work(key);
+        expand_subprocess_map.erase(finished.first);
     }
 }
-
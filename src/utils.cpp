@@ -1,26 +1,29 @@
 #ifndef NO_GSL
 #include <gsl/gsl_randist.h>
 #endif // NO_GSL
+#include <sstream>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
 #include "utils.hpp"
 
-std::pair<bool, GiNaC::ex> get_prefactor(const std::string& id, int t, int L,
+std::pair<bool, GiNaC::ex> get_prefactor(const integral_index& id, int t, int L,
                                          const GiNaC::ex& d,
                                          bool sector_designate,
                                          std::size_t top_level_sector) {
-    auto indices = split(id.c_str());
-    int len = indices.size();
+    int len = id.size();
     int total_a = 0;
     GiNaC::ex prefactor = 1;
     bool fail = false;
     for (int i = 0; i < len; i++) {
         if (sector_designate && !(top_level_sector & (1 << i)))
             continue;
-        if (indices[i] <= 0) {
+        if (id[i] <= 0) {
             fail = true;
             break;
         }
-        prefactor *= GiNaC::tgamma(indices[i]);
-        total_a += indices[i];
+        prefactor *= GiNaC::tgamma(id[i]);
+        total_a += id[i];
     }
     if (total_a < t)
         fail = true;
@@ -33,38 +36,104 @@ std::pair<bool, GiNaC::ex> get_prefactor(const std::string& id, int t, int L,
     return std::make_pair(true, prefactor);
 }
 
-std::vector<int> split(const char* str) {
-    std::vector<int> nums;
-    const char* ptr = str;
-    char* endptr;
-    while (true) {
-        nums.push_back(std::strtol(ptr, &endptr, 10));
-        if (*endptr == '\0')
-            return nums;
-        ptr = endptr + 1;
+bool has_non_null_key(const YAML::Node& node, const std::string& key) {
+    auto node_map = node.as<std::map<std::string, YAML::Node>>();
+    return node_map.find(key) != node_map.end() && node[key].Type() != YAML::NodeType::Null;
+}
+
+static std::filesystem::path current_log_dir = "logs";
+
+std::filesystem::path log_dir() {
+    std::filesystem::create_directories(current_log_dir);
+    return current_log_dir;
+}
+
+void set_log_dir(const std::filesystem::path& path) {
+    current_log_dir = path;
+}
+
+std::uint64_t hash_bytes(const char* data, std::size_t size, std::uint64_t seed) {
+    const std::uint64_t multiplier = 0x9e3779b97f4a7c15ULL;
+    std::uint64_t h = seed;
+    std::size_t pos = 0;
+    for (; pos + sizeof(std::uint64_t) <= size; pos += sizeof(std::uint64_t)) {
+        std::uint64_t word;
+        std::memcpy(&word, data + pos, sizeof(word));
+        h = (h ^ word) * multiplier;
+        h ^= (h >> 29);
     }
+    for (; pos < size; pos++)
+        h = (h ^ (unsigned char)data[pos]) * 0x100000001b3ULL;
+    return h;
+}
+
+std::uint64_t hash_string(const std::string& str, std::uint64_t seed) {
+    // also hash the length, so that consecutive strings cannot alias
+    std::uint64_t length = str.size();
+    return hash_bytes(str.data(), str.size(), hash_bytes((const char*)&length, sizeof(length), seed));
 }
 
-std::string combine(const std::vector<int>& values) {
-    std::string str = "";
-    int num_values = values.size();
-    for (int i = 0; i < num_values; i++) {
-        str += std::to_string(values[i]);
-        if (i != num_values - 1)
-            str += ",";
+std::uint64_t hash_file(const std::string& filename, std::uint64_t seed) {
+    std::ifstream in(filename, std::ios::binary);
+    if (!in)
+        throw std::runtime_error("hash_file(): cannot open " + filename);
+    std::vector<char> buffer(1 << 22);
+    std::uint64_t h = seed;
+    while (in) {
+        in.read(buffer.data(), buffer.size());
+        h = hash_bytes(buffer.data(), in.gcount(), h);
     }
-    return str;
+    return h;
 }
 
-bool has_non_null_key(const YAML::Node& node, const std::string& key) {
-    auto node_map = node.as<std::map<std::string, YAML::Node>>();
-    return node_map.find(key) != node_map.end() && node[key].Type() != YAML::NodeType::Null;
+std::string to_hex(std::uint64_t value) {
+    char str[17];
+    std::snprintf(str, sizeof(str), "%016llx", (unsigned long long)value);
+    return str;
 }
 
 double to_double(const GiNaC::ex& ex) {
     return GiNaC::ex_to<GiNaC::numeric>(GiNaC::ex_to<GiNaC::numeric>(ex).evalf()).to_double();
 }
 
+std::string serialize(const GiNaC::ex& ex) {
+    GiNaC::archive ar;
+    ar.archive_ex(ex, "coeff");
+    std::ostringstream out;
+    out << ar;
+    return out.str();
+}
+
+GiNaC::ex deserialize(const std::string& bytes, const GiNaC::lst& syms) {
+    GiNaC::archive ar;
+    std::istringstream in(bytes);
+    in >> ar;
+    return ar.unarchive_ex(syms, "coeff");
+}
+
+std::string pack_strings(const std::vector<std::string>& strings) {
+    std::string packed;
+    for (auto& str: strings) {
+        std::uint64_t length = str.size();
+        packed.append((const char*)&length, sizeof(length));
+        packed.append(str);
+    }
+    return packed;
+}
+
+std::vector<std::string> unpack_strings(const std::string& packed) {
+    std::vector<std::string> strings;
+    std::size_t pos = 0, size = packed.size();
+    while (pos + sizeof(std::uint64_t) <= size) {
+        std::uint64_t length;
+        std::memcpy(&length, packed.data() + pos, sizeof(length));
+        pos += sizeof(length);
+        strings.push_back(packed.substr(pos, length));
+        pos += length;
+    }
+    return strings;
+}
+
 GiNaC::matrix adjugate(const GiNaC::matrix& M) {
     auto n = M.rows(), m = M.cols();
     if (n != m)
@@ -100,6 +169,10 @@ random_feynman_params::~random_feynman_params() {
     gsl_rng_free(rng);
 }
 
+void random_feynman_params::seed(unsigned long new_seed) {
+    gsl_rng_set(rng, new_seed);
+}
+
 void random_feynman_params::operator()(std::vector<double>& slots) {
     gsl_ran_dirichlet(rng, length, alpha.data(), slots.data());
 }